@@ -0,0 +1,284 @@
+// bench/gomoku_bench.cpp
+// 绘制性能基准：Lcd 图元、Image 贴图、Font 文字的吞吐量
+//
+// 用法：gomoku_bench [--lcd PATH] [--font PATH] [--samples N] [--filter STR] [--format table|csv|json]
+//   --lcd     显示设备，默认 /dev/fb0；在 PC 上可用 headless:800x480x16 之类的内存后端
+//   --font    TTF 字体路径，默认 SimSun.ttf，加载失败时跳过文字相关用例
+//   --samples 每个用例的采样次数，默认 50
+//   --filter  只运行名字里包含 STR 的用例
+//   --format  输出格式，csv / json 方便脚本比较回归
+#include "../include/lcd.h"
+#include "../include/image.h"
+#include "../include/font.h"
+#include "../include/label_cache.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct BenchOptions {
+    std::string lcd_path = kDefaultLcdPath;
+    std::string font_path = "SimSun.ttf";
+    std::string filter;
+    std::string format = "table";
+    int samples = 50;
+};
+
+struct BenchResult {
+    std::string name;
+    std::string unit;     // 吞吐量的计量单位：px / frame / glyph / circle
+    double work;          // 每次调用完成的工作量 (单位同上)
+    long calls;           // 实际计时的调用次数
+    double median_us;     // 单次调用耗时的分位数
+    double p90_us;
+    double p99_us;
+    double min_us;
+};
+
+// 计时一个用例：
+// 1. 预热并标定：每个样本包含 batch 次调用，保证单个样本至少 2ms，降低取时钟本身的影响
+// 2. 采样：记录每个样本里单次调用的平均耗时，最后取分位数
+BenchResult run_case(const BenchOptions& opt, const std::string& name, const std::string& unit,
+                     double work, const std::function<void()>& fn) {
+    const auto kMinSample = std::chrono::milliseconds(2);
+
+    long batch = 1;
+    for (;;) {
+        auto start = Clock::now();
+        for (long i = 0; i < batch; ++i) fn();
+        if (Clock::now() - start >= kMinSample || batch >= (1L << 24)) break;
+        batch *= 2;
+    }
+
+    std::vector<double> per_call_us;
+    per_call_us.reserve(opt.samples);
+    for (int s = 0; s < opt.samples; ++s) {
+        auto start = Clock::now();
+        for (long i = 0; i < batch; ++i) fn();
+        std::chrono::duration<double, std::micro> elapsed = Clock::now() - start;
+        per_call_us.push_back(elapsed.count() / batch);
+    }
+    std::sort(per_call_us.begin(), per_call_us.end());
+
+    auto percentile = [&](double p) {
+        size_t index = static_cast<size_t>(p * (per_call_us.size() - 1) + 0.5);
+        return per_call_us[index];
+    };
+    return {name, unit, work, batch * opt.samples,
+            percentile(0.5), percentile(0.9), percentile(0.99), per_call_us.front()};
+}
+
+// 生成测试用的 BMP 文件：24 位为实心渐变，32 位为四角透明的圆形 (与棋子贴图类似)
+std::string write_test_bmp(int width, int height, int bit_count) {
+    char path[] = "/tmp/gomoku_bench_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        throw std::runtime_error("mkstemp failed: " + std::string(strerror(errno)));
+    }
+
+    int bytes_per_pixel = bit_count / 8;
+    int row_bytes = (width * bit_count + 31) / 32 * 4;
+    uint32_t data_size = row_bytes * height;
+
+    // 手工拼 BITMAPFILEHEADER (14 字节) + BITMAPINFOHEADER (40 字节)，小端
+    std::vector<unsigned char> file(54 + data_size, 0);
+    auto put16 = [&](size_t at, uint16_t v) { memcpy(&file[at], &v, 2); };
+    auto put32 = [&](size_t at, uint32_t v) { memcpy(&file[at], &v, 4); };
+    put16(0, 0x4D42);
+    put32(2, static_cast<uint32_t>(file.size()));
+    put32(10, 54);
+    put32(14, 40);
+    put32(18, width);
+    put32(22, height);
+    put16(26, 1);
+    put16(28, bit_count);
+    put32(34, data_size);
+
+    const int cx = width / 2, cy = height / 2, r = std::min(width, height) / 2;
+    for (int y = 0; y < height; ++y) {
+        unsigned char* row = &file[54 + y * row_bytes];
+        for (int x = 0; x < width; ++x) {
+            unsigned char* p = row + x * bytes_per_pixel;
+            p[0] = static_cast<unsigned char>(x * 255 / width);
+            p[1] = static_cast<unsigned char>(y * 255 / height);
+            p[2] = 0x80;
+            if (bytes_per_pixel == 4) {
+                bool inside = (x - cx) * (x - cx) + (y - cy) * (y - cy) <= r * r;
+                p[3] = inside ? 0xFF : 0x00;
+            }
+        }
+    }
+
+    bool ok = write(fd, file.data(), file.size()) == static_cast<ssize_t>(file.size());
+    close(fd);
+    if (!ok) {
+        unlink(path);
+        throw std::runtime_error("Failed to write test BMP");
+    }
+    return path;
+}
+
+// UTF-8 字符串中的字符个数 (不计续字节)
+int count_glyphs(const std::string& text) {
+    return static_cast<int>(std::count_if(text.begin(), text.end(),
+                                          [](char c) { return (c & 0xC0) != 0x80; }));
+}
+
+void print_results(const BenchOptions& opt, const std::vector<BenchResult>& results) {
+    if (opt.format == "csv") {
+        std::printf("name,unit,work,calls,median_us,p90_us,p99_us,min_us,throughput\n");
+        for (const auto& r : results) {
+            std::printf("%s,%s,%.0f,%ld,%.3f,%.3f,%.3f,%.3f,%.1f\n", r.name.c_str(), r.unit.c_str(),
+                        r.work, r.calls, r.median_us, r.p90_us, r.p99_us, r.min_us,
+                        r.work / r.median_us * 1e6);
+        }
+    } else if (opt.format == "json") {
+        std::printf("[\n");
+        for (size_t i = 0; i < results.size(); ++i) {
+            const auto& r = results[i];
+            std::printf("  {\"name\": \"%s\", \"unit\": \"%s\", \"work\": %.0f, \"calls\": %ld, "
+                        "\"median_us\": %.3f, \"p90_us\": %.3f, \"p99_us\": %.3f, \"min_us\": %.3f, "
+                        "\"throughput\": %.1f}%s\n",
+                        r.name.c_str(), r.unit.c_str(), r.work, r.calls, r.median_us, r.p90_us,
+                        r.p99_us, r.min_us, r.work / r.median_us * 1e6,
+                        i + 1 < results.size() ? "," : "");
+        }
+        std::printf("]\n");
+    } else {
+        std::printf("%-28s %10s %10s %10s %18s\n", "case", "median us", "p90 us", "p99 us", "throughput");
+        for (const auto& r : results) {
+            std::printf("%-28s %10.2f %10.2f %10.2f %12.4g %s/s\n", r.name.c_str(), r.median_us,
+                        r.p90_us, r.p99_us, r.work / r.median_us * 1e6, r.unit.c_str());
+        }
+    }
+}
+
+bool parse_args(int argc, char* argv[], BenchOptions& opt) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            std::fprintf(stderr, "Missing value for %s\n", arg.c_str());
+            return false;
+        }
+        std::string value = argv[++i];
+        if (arg == "--lcd") opt.lcd_path = value;
+        else if (arg == "--font") opt.font_path = value;
+        else if (arg == "--filter") opt.filter = value;
+        else if (arg == "--format") opt.format = value;
+        else if (arg == "--samples") opt.samples = std::max(1, atoi(value.c_str()));
+        else {
+            std::fprintf(stderr, "Unknown option %s\n", arg.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    BenchOptions opt;
+    if (!parse_args(argc, argv, opt)) return 2;
+
+    try {
+        Lcd& screen = Lcd::get_instance(opt.lcd_path);
+        const int w = screen.get_width();
+        const int h = screen.get_height();
+
+        std::vector<BenchResult> results;
+        auto bench = [&](const std::string& name, const std::string& unit, double work,
+                         const std::function<void()>& fn) {
+            if (!opt.filter.empty() && name.find(opt.filter) == std::string::npos) return;
+            results.push_back(run_case(opt, name, unit, work, fn));
+        };
+
+        // --- Lcd 图元 ---
+        // 逐像素写入作为参照，对比下面按行填充的 render_rectangle
+        bench("lcd.render_pixel_200x60", "px", 200 * 60, [&] {
+            for (int y = 200; y < 260; ++y)
+                for (int x = 300; x < 500; ++x)
+                    screen.render_pixel(x, y, 0x00FFFFFF);
+        });
+        bench("lcd.clear", "px", static_cast<double>(w) * h, [&] { screen.clear(0x00336699); });
+        bench("lcd.rectangle_200x60", "px", 200 * 60, [&] {
+            screen.render_rectangle(200, 60, 300, 200, 0x00FFFFFF);
+        });
+        bench("lcd.circle_r14", "circle", 1, [&] { screen.render_circle(14, 400, 240, 0x00000000); });
+        bench("lcd.circle_r14_aa", "circle", 1, [&] {
+            screen.render_circle(14, 400, 240, 0x00000000, true);
+        });
+        bench("lcd.show_full", "frame", 1, [&] {
+            screen.mark_dirty(0, 0, w, h);
+            screen.show();
+        });
+        bench("lcd.show_one_stone", "frame", 1, [&] {
+            screen.render_circle(14, 400, 240, 0x00FFFFFF);
+            screen.show();
+        });
+
+        // --- Image 贴图 ---
+        std::string bmp24 = write_test_bmp(200, 200, 24);
+        std::string bmp32 = write_test_bmp(64, 64, 32);
+        {
+            Image background(bmp24);
+            Image sprite(bmp32);
+            bench("image.draw_24bit_200x200", "px", 200 * 200, [&] { background.draw(screen, 100, 100); });
+            bench("image.draw_32bit_64x64", "px", 64 * 64, [&] { sprite.draw(screen, 100, 100); });
+        }
+        unlink(bmp24.c_str());
+        unlink(bmp32.c_str());
+
+        // --- Font 文字 ---
+        std::unique_ptr<Font> font;
+        try {
+            font = std::make_unique<Font>(opt.font_path, 24);
+        } catch (std::exception& e) {
+            std::fprintf(stderr, "[Warn] %s, skipping font cases\n", e.what());
+        }
+        if (font) {
+            const std::string ascii = "Black 12:34 White 10:05";
+            const std::string cjk = "重新开始黑方胜利悔棋";
+            bench("font.draw_ascii", "glyph", count_glyphs(ascii), [&] {
+                font->draw_text(screen, ascii, 20, 20, 0x00000000);
+            });
+            bench("font.draw_cjk", "glyph", count_glyphs(cjk), [&] {
+                font->draw_text(screen, cjk, 20, 60, 0x00000000);
+            });
+            // 距离场字形：每次绘制都从图集采样，对比上面直接贴点阵的开销 (.gbf 点阵字体没有 SDF 模式)
+            std::unique_ptr<Font> sdf_font;
+            try {
+                sdf_font = std::make_unique<Font>(opt.font_path, 24, GlyphMode::SDF);
+            } catch (std::exception& e) {
+                std::fprintf(stderr, "[Warn] %s, skipping SDF font case\n", e.what());
+            }
+            if (sdf_font) {
+                bench("font.draw_ascii_sdf", "glyph", count_glyphs(ascii), [&] {
+                    sdf_font->draw_text(screen, ascii, 20, 140, 0x00000000);
+                });
+            }
+            // 同一段文字第二次起直接贴缓存好的位图
+            bench("font.draw_label_cached", "glyph", count_glyphs(ascii), [&] {
+                LabelCache::get_instance().draw(screen, *font, ascii, 20, 100, 0x00000000);
+            });
+        }
+
+        print_results(opt, results);
+    } catch (std::exception& e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
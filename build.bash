@@ -13,6 +13,8 @@ cd build
 echo ">>> 正在生成 32 位 ARM 的 CMake 配置..."
 cmake -DCMAKE_C_COMPILER=arm-linux-gnueabihf-gcc \
       -DCMAKE_CXX_COMPILER=arm-linux-gnueabihf-g++ \
+      -DGOMOKU_NEON=ON \
+      -DGOMOKU_TOOLS=OFF \
       ..
 
 # 4. 执行编译（-j4 表示使用 4 个线程并行编译）
@@ -0,0 +1,58 @@
+// include/baked_font.h
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// 预烘焙的点阵字体文件格式 (.gbf)，由 tools/font_baker 离线生成
+// 整个文件可以直接 mmap 使用，运行时不需要解析 TrueType，也不需要光栅化
+//
+// 布局 (全部小端、4 字节对齐)：
+//   BakedFontHeader
+//   BakedFace[face_count]          每个字号一项
+//   每个字号的 BakedGlyph[]        按 codepoint 升序，可二分查找
+//   每个字号的 BakedKernPair[]     按 (left, right) 升序
+//   每个字号的覆盖率点阵            单通道 8 位，按行紧密排列
+
+constexpr char kBakedFontMagic[4] = {'G', 'B', 'F', '1'};
+constexpr uint32_t kBakedFontVersion = 1;
+
+struct BakedFontHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t face_count;
+    uint32_t reserved;
+};
+
+struct BakedFace {
+    float pixel_size;       // 烘焙时的字号 (像素高度)
+    int32_t ascent;         // 已按字号缩放的垂直度量 (像素)
+    int32_t descent;
+    int32_t line_gap;
+    uint32_t glyph_count;
+    uint32_t glyph_offset;  // BakedGlyph 数组在文件中的偏移
+    uint32_t kern_count;
+    uint32_t kern_offset;   // BakedKernPair 数组在文件中的偏移
+    uint32_t bitmap_offset; // 本字号点阵区的起始偏移
+    uint32_t bitmap_size;
+};
+
+struct BakedGlyph {
+    uint32_t codepoint;
+    float advance;          // 笔位置前进量 (像素)
+    int16_t x0, y0;         // 点阵左上角相对 (笔位置, 基线) 的偏移
+    uint16_t width, height;
+    uint32_t bitmap_offset; // 相对 BakedFace::bitmap_offset
+};
+
+struct BakedKernPair {
+    uint32_t left;          // 前一个字的 codepoint
+    uint32_t right;         // 后一个字的 codepoint
+    float adjust;           // 追加到前进量上的调整 (像素，通常为负)
+};
+
+inline bool is_baked_font(const unsigned char* data, size_t size) {
+    return size >= sizeof(BakedFontHeader) &&
+           data[0] == kBakedFontMagic[0] && data[1] == kBakedFontMagic[1] &&
+           data[2] == kBakedFontMagic[2] && data[3] == kBakedFontMagic[3];
+}
@@ -2,15 +2,38 @@
 #pragma once
 
 #include <linux/input.h>
+#include <atomic>
+#include <cstdint>
+#include <functional>
 #include <string>
+#include <thread>
+#include "../include/spsc_queue.h"
+
+class EventLoop;
 
 constexpr char kDefaultInputDevPath[] = "/dev/input/event0";
 
+// 多点触摸协议 B 的一个触点 (坐标已映射到 LCD)
+struct TouchContact {
+    int id = -1;          // ABS_MT_TRACKING_ID：手指从按下到抬起保持不变
+    int x = 0;
+    int y = 0;
+    int touch_major = 0;  // 接触面长轴 (触摸屏原始单位，驱动不报告时为 0)，可用来识别手掌
+    bool is_palm = false; // 手掌：驱动标成了 MT_TOOL_PALM，或接触面超过了手掌阈值；不参与主触点和多指判断
+};
+
+// 同时跟踪的触点上限 (超出的槽位忽略)
+constexpr int kMaxTouchContacts = 10;
+
 // 自定义一个简化的触摸点结构体，方便游戏逻辑调用
+// x / y / is_pressed 是单点视角 (主触点)；contacts 是这一帧所有按着的触点，供双指缩放、防误触使用
 struct TouchPoint {
-    int x;
-    int y;
-    bool is_pressed; // true 为按下，false 为松开
+    int x = 0;
+    int y = 0;
+    bool is_pressed = false; // true 为按下，false 为松开
+    int64_t time_us = 0; // 这一帧的内核时间戳 (SYN_REPORT 的 input_event::time，CLOCK_MONOTONIC，微秒)
+    int contact_count = 0;
+    TouchContact contacts[kMaxTouchContacts];
     friend TouchPoint& operator+(const TouchPoint& other);
     friend TouchPoint& operator-(const TouchPoint& other);
 };
@@ -32,18 +55,116 @@ public:
     InputEvent& operator=(const InputEvent&) = delete;
     ~InputEvent();
 
-    // 底层接口：读取一次原始事件
+    // 底层接口：取出一个原始事件 (设备以 O_NONBLOCK 打开，暂时没有数据时返回 false)
+    // 事件从内部缓冲区里取，缓冲区空了才发起一次 read，一次最多读 kEventBatch 个
     bool read_raw_event(struct input_event& ev);
 
     // 高层接口：获取经过映射的触摸点坐标 (自动映射到屏幕分辨率)
+    // 只消化已经到达的事件：凑齐一帧 (EV_SYN) 才返回 true，读了一半的帧留到下次继续拼
+    // 开启输入线程后设备归那个线程所有，UI 线程改用 pop_touch_point
     bool get_touch_point(TouchPoint& point);
 
+    // --- 可选的输入线程 ---
+    // 由专门的线程独占设备 fd，拼装好的触摸点经无锁队列交给 UI 线程，
+    // 主线程画得慢或 AI 在思考时也不会耽误读取，内核的 evdev 缓冲区不会因此溢出。
+    // 应在 attach 之前调用；队列满时丢弃最新的点并计数
+    void start_thread();
+    void stop_thread();
+    bool is_threaded() const { return input_thread_.joinable(); }
+    size_t get_dropped_points() const { return dropped_points_; }
+
+    // 取下一个触摸点：线程模式下从队列里取，否则直接从设备读
+    bool pop_touch_point(TouchPoint& point);
+
+    // 非阻塞的手势识别：消化已到达的事件，恰好完成一次"按下-抬起"时返回 true
+    // 按住期间出现过两个及以上触点 (双指缩放等) 的这一次结果为 NONE，不会被当成点击或滑动
+    bool poll_gesture(EventStatus& status, TouchPoint& out_point);
+
+    // 阻塞版本：一直等到完成一次完整的手势 (内部 poll 等待，不在 read 里死等)
+    // 设备拔掉、出错或回放文件读完后返回 NONE，不再等待
     EventStatus get_current_status(TouchPoint& out_point);
+
+    // 把触摸屏挂到事件循环上：设备可读时识别手势，每识别出一个就回调一次
+    // 设备拔掉或出错时自动从事件循环里摘掉；回放的普通文件不经过 epoll，投递成一个任务一次放完
+    using GestureHandler = std::function<void(EventStatus status, const TouchPoint& point)>;
+    void attach(EventLoop& loop, GestureHandler handler);
+
+    // UI 线程应当等待的 fd：线程模式下是输入线程的通知 eventfd，否则就是设备本身
+    int get_fd() const { return is_threaded() ? notify_fd_ : dev_fd_; }
+    bool is_lost() const { return device_lost_; }
 private:
     explicit InputEvent(const std::string& dev_path);
+
+    void input_thread_main();
+    void drain_notify();
+
+    // SYN_DROPPED 之后用 EVIOCGABS / EVIOCGKEY / EVIOCGMTSLOTS 直接向驱动要当前的坐标、按下状态和触点表，
+    // 补回丢掉的那部分
+    void resync_state();
+
+    // 一帧结束时把触点表里按着的触点抄进 current_.contacts；
+    // 设备不报告单点的 ABS_X / ABS_Y 时，顺便用最早按下的触点充当主触点
+    void publish_contacts();
+
+    // 触摸屏物理坐标 -> LCD 坐标
+    int map_x(int raw) const;
+    int map_y(int raw) const;
+
+    // 由按下/抬起两个点和按住的时长判定手势，点击时把坐标写进 out_point
+    EventStatus classify(const TouchPoint& start, const TouchPoint& end, long duration_ms,
+                         TouchPoint& out_point) const;
+
     int dev_fd_;
 
+    // 批量读取的缓冲区：[event_head_, event_tail_) 是读到了还没消化的事件
+    // 一个触摸采样通常有 5~8 个事件，一次 read 就能拿到好几帧
+    static constexpr int kEventBatch = 64;
+    struct input_event event_buffer_[kEventBatch];
+    int event_head_;
+    int event_tail_;
+
+    // 正在拼装的触摸点 (跨多次非阻塞读取保留)
+    TouchPoint current_;
+    bool point_updated_;
+    bool dropping_;  // 收到 SYN_DROPPED 后丢弃事件直到下一个 SYN_REPORT
+
+    // 多点触摸槽位表 (协议 B)：事件只报告变化的槽位，其余保持上一帧的值
+    struct ContactSlot {
+        int tracking_id = -1;  // -1 表示槽位空闲
+        int x = 0;
+        int y = 0;
+        int touch_major = 0;
+        bool is_palm = false;
+        uint32_t down_seq = 0; // 按下的先后顺序，用来挑主触点
+    };
+    ContactSlot slots_[kMaxTouchContacts];
+    int current_slot_;        // ABS_MT_SLOT 选中的槽位，超出上限时为 -1
+    int slot_count_;          // 设备的槽位数 (不超过 kMaxTouchContacts)
+    uint32_t contact_seq_;
+    bool has_single_axes_;    // 见过 ABS_X / ABS_Y：主触点坐标直接用它们
+    int palm_touch_major_;    // touch_major 达到这个值就当作手掌 (原始单位)，0 表示设备不报告接触面
+
+    // 输入线程：touch_queue_ 由它写、UI 线程读；notify_fd_ 通知 UI 线程，stop_fd_ 让它退出
+    static constexpr size_t kTouchQueueSize = 256;
+    SpscQueue<TouchPoint, kTouchQueueSize> touch_queue_;
+    std::thread input_thread_;
+    int notify_fd_;
+    int stop_fd_;
+    std::atomic<size_t> dropped_points_;
+
+    // 设备已经不可用 (拔掉、出错或读到文件末尾)：不再读它，等待它的地方直接返回
+    std::atomic<bool> device_lost_;
+
+    // 手势状态机：按下时记录起点，抬起时结算 (时长用两个点的内核时间戳相减，不受读取延迟影响)
+    bool gesture_active_;
+    bool gesture_multi_;  // 本次按住期间出现过多个触点
+    TouchPoint gesture_start_;
+
     // 保存触摸屏底层的真实物理分辨率范围，用于坐标映射
     int touch_max_x_;
     int touch_max_y_;
+
+    // 映射目标：构造时从 Lcd 取一次的屏幕分辨率
+    int screen_width_;
+    int screen_height_;
 };
\ No newline at end of file
@@ -0,0 +1,57 @@
+// include/event_loop.h
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// UI 线程的事件循环 (全局单例)：epoll 同时等待输入设备、定时器 (timerfd) 和跨线程唤醒 (eventfd)，
+// 哪个就绪就回调哪个。UI 线程只会睡在 epoll_wait 里，有活干的时候绝不会卡在某个阻塞的 read 上。
+class EventLoop {
+public:
+    // events 为 epoll 的就绪事件 (EPOLLIN / EPOLLERR ...)
+    using FdHandler = std::function<void(uint32_t events)>;
+    using Task = std::function<void()>;
+
+    static EventLoop& get_instance();
+
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+    ~EventLoop();
+
+    // 监听一个 (应当是非阻塞的) fd；同一个 fd 重复添加会替换回调
+    void add_fd(int fd, uint32_t events, FdHandler handler);
+    void remove_fd(int fd);
+
+    // 定时器：每个定时器一个 timerfd，返回值用于取消。
+    // 回调来不及处理时多次到期只回调一次 (帧定时器不会补帧)
+    int add_timer(std::chrono::milliseconds interval, Task callback, bool repeat = true);
+    void cancel_timer(int timer_id);
+
+    // 从任意线程投递一个任务到 UI 线程执行 (例如 AI 算完后落子)，通过 eventfd 唤醒 epoll_wait
+    void post(Task task);
+
+    // 在当前线程运行循环，直到 stop()；stop 可以在任意线程或回调里调用
+    void run();
+    void stop();
+
+private:
+    EventLoop();
+
+    void run_posted_tasks();
+
+    static constexpr int kMaxEvents = 16;
+
+    int epoll_fd_;
+    int wake_fd_;     // eventfd
+    std::atomic<bool> running_;
+
+    std::unordered_map<int, FdHandler> handlers_;
+
+    std::mutex task_mutex_;
+    std::vector<Task> tasks_;
+};
@@ -1,16 +1,89 @@
 // include/font.h
 #pragma once
 
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 #include "../include/lcd.h"
+#include "../include/baked_font.h"
+#include "../include/utf8.h"
+#include "../include/sdf_atlas.h"
 #include "stb_truetype.h" // 刚刚下载的神器
 
+// 只读映射 (mmap) 的字体文件：启动时不做整块拷贝，字形用到哪页才读哪页
+// 同一路径的所有 Font (不同字号) 共享一份映射，最后一个使用者释放时自动 munmap
+class FontFile {
+public:
+    static std::shared_ptr<FontFile> open(const std::string& path);
+    ~FontFile();
+
+    FontFile(const FontFile&) = delete;
+    FontFile& operator=(const FontFile&) = delete;
+
+    const unsigned char* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    FontFile(const unsigned char* data, size_t size) : data_(data), size_(size) {}
+
+    const unsigned char* data_;
+    size_t size_;
+};
+
+// 文字对齐方式 (多行时每行各自在文字块内对齐)
+enum class TextAlign { LEFT, CENTER, RIGHT };
+
+// 排版结果：所有坐标都相对文字块的左上角
+struct TextLayout {
+    struct GlyphPos {
+        int codepoint;
+        int x;         // 笔位置的整数部分
+        int subpixel;  // 笔位置的小数部分，单位 1/Font::kSubpixelSteps 像素
+        int baseline;  // 所在行的基线
+    };
+    std::vector<GlyphPos> glyphs;
+    std::vector<int> line_widths; // 每行的前进宽度 (不含行尾空格)
+    int width;                    // 文字块宽度：指定了 max_width 时就是它，否则为最宽的一行
+    int height;                   // 行数 * 行高
+    Rect ink;                     // 真正有像素的包围盒
+};
+
+// 字形缓存的命中统计
+struct GlyphCacheStats {
+    size_t hits;
+    size_t misses;
+    size_t glyphs;       // 已缓存的字形个数
+    size_t arena_bytes;  // 所有点阵占用的字节数
+};
+
+// 字形的生成方式
+enum class GlyphMode {
+    BITMAP, // 按本字号直接光栅化成覆盖率点阵 (默认，小字号最清晰)
+    SDF     // 从字体文件共享的距离场图集缩放采样，多个字号共用一份图集
+};
+
+// 后台字形预热的进度
+struct WarmupProgress {
+    size_t done;         // 已经处理的字形个数 (每个亚像素档算一个)
+    size_t total;
+    size_t arena_bytes;  // 本字体与后备字体的点阵内存池 (及 SDF 图集) 合计大小
+    bool finished;       // 全部完成、达到内存上限或被中途停止
+};
+
 class Font {
 public:
+    // 水平亚像素定位的档数：笔位置按 1/4 像素取整，每一档单独光栅化 (仅 TTF，点阵字体只有整像素)
+    static constexpr int kSubpixelSteps = 4;
+
     // 初始化字体，传入 ttf 文件路径和需要的字号大小 (像素)
-    explicit Font(const std::string& ttf_path, float font_size);
-    ~Font() = default;
+    // 也可以传入 font_baker 生成的 .gbf 点阵字体，此时字号必须是烘焙过的字号之一
+    // mode 为 SDF 时 (仅 TTF) 本字号不再保存点阵，适合标题、按钮、坐标等同一批字出现在多个字号的场合
+    explicit Font(const std::string& ttf_path, float font_size, GlyphMode mode = GlyphMode::BITMAP);
+    ~Font();
 
     // 禁用拷贝
     Font(const Font&) = delete;
@@ -20,15 +93,159 @@ public:
     // start_x, start_y 为文字左上角的起始坐标
     void draw_text(Lcd& screen, const std::string& text, int start_x, int start_y, uint32_t color);
 
+    // --- 测量与排版 ---
+    // 行高 = ascent - descent + line_gap
+    int get_line_height() const;
+
+    // 排版一段文字：'\n' 换行，max_width > 0 时自动折行 (空格后或中文字之间)
+    // 结果按 (文本, 宽度, 对齐) 缓存在本 Font (即本字号) 里，重复排版同一标签是一次查表
+    std::shared_ptr<const TextLayout> layout_text(const std::string& text, int max_width = 0,
+                                                  TextAlign align = TextAlign::LEFT);
+
+    // 只关心尺寸时的便捷接口 (内部同样走缓存)
+    TextLayout measure_text(const std::string& text, int max_width = 0);
+
+    // 按排版结果绘制，start_x / start_y 为文字块左上角
+    void draw_layout(Lcd& screen, const TextLayout& layout, int start_x, int start_y, uint32_t color);
+
+    // 把整段排版结果的覆盖率叠加到一张 mask 上 (mask 左上角对应文字块坐标 layout.ink.x/y)
+    // mask 尺寸为 layout.ink.width x layout.ink.height，调用方负责清零
+    void render_mask(const TextLayout& layout, unsigned char* mask);
+
+    // 后备字体链：本字体没有的字依次去 fallback 里找 (例如小巧的西文字体在前，中文字体在后)
+    // 每个字只在第一次出现时沿链查找一次，结果记在码位 -> 字形索引缓存里
+    // fallback 由调用方持有且须比本字体活得久，字号一般与本字体相同；应在绘制前设置好
+    // (调用后 get_id() 会换成新编号，LabelCache 里本字体的旧标签不再使用)
+    void add_fallback(Font& fallback);
+
+    // --- 后台预热 ---
+    // 在后台线程里把 charset (UTF-8) 中的字预先光栅化进字形缓存，界面首次出现时就不用现场光栅化
+    // 先把所有字的整像素版本做完，再做其余亚像素档；点阵内存池超过 memory_cap 字节就提前结束
+    // (由后备字体负责的字占用的是后备字体的内存池，一并计入)
+    // (只限制预热，按需光栅化不受影响)。再次调用会先停掉上一次的预热。
+    // 预热期间可以照常在主线程绘制；只有缓存的读写是加锁的，Font 的其它接口仍然只能在一个线程里用
+    static constexpr size_t kDefaultWarmupCap = 2 * 1024 * 1024;
+    void start_warmup(const std::string& charset, size_t memory_cap = kDefaultWarmupCap);
+    WarmupProgress get_warmup_progress() const;
+    void wait_warmup();
+    void stop_warmup();
+
+    // 按逗号分隔的描述拼出预热字符表：digits、ascii (可打印 ASCII)，其它项当作 UTF-8 字符表文件
+    // (例如 GB2312 一级字库的字表，或 font_baker --charset 用的同一份文件)
+    static std::string load_charset(const std::string& spec);
+
+    // 每个 Font 实例独一无二的编号，外部缓存用它 (而不是地址) 区分字体
+    uint32_t get_id() const { return id_; }
+
+    GlyphCacheStats get_cache_stats() const;
+
 private:
-    std::vector<unsigned char> font_buffer_; // 用于在内存中保存整个 ttf 文件
+    // 一个已经光栅化好的字形：度量信息 + 覆盖率点阵
+    struct Glyph {
+        float advance;                // 笔位置前进量 (像素，带小数)
+        int x0, y0;                   // 点阵左上角相对 (笔位置, 基线) 的偏移
+        int width, height;
+        const unsigned char* bitmap;  // 按行紧密排列；指向内存池或 .gbf 文件映射，地址不会变
+
+        // SDF 字形没有点阵，绘制时按下面的参数从图集采样出覆盖率
+        const SdfAtlas::SdfGlyph* sdf = nullptr;
+        float sdf_ratio = 0.0f;       // 本字号 / 图集基准字号
+        float shift_x = 0.0f;         // 亚像素偏移
+    };
+
+    // 码位解析结果：由后备链里哪个字体负责，以及它内部的字形索引 (-1 表示整条链都没有)
+    struct GlyphRef {
+        Font* font;
+        int index;
+    };
+
+    // 取出字形，未命中时才真正去跑 TrueType 光栅化 (或去点阵字体里查表)
+    // subpixel 为笔位置小数部分所在的档 (0 ~ kSubpixelSteps - 1)
+    const Glyph& get_glyph(int codepoint, int subpixel = 0);
+    Glyph rasterize_glyph(int glyph_index, int subpixel);
+    Glyph find_baked_glyph(int glyph_index) const;
+
+    // 码位 -> (字体, 字形索引)，先查直接映射缓存，未命中才沿后备链查 cmap
+    GlyphRef resolve_glyph(int codepoint);
+    // 只查本字体：TTF 走 cmap，点阵字体二分查找；没有时返回 -1
+    int find_glyph_index(int codepoint) const;
+
+    // 字偶距 (像素)：按 (前一个字, 后一个字) 缓存，每一对只查一次字体表
+    float get_kerning(int left, int right);
+    float find_baked_kerning(int left, int right) const;
+
+    // 字形的覆盖率点阵：普通字形直接返回 bitmap，SDF 字形现场采样到临时缓冲区里
+    const unsigned char* glyph_coverage(const Glyph& glyph);
+    void render_sdf(const Glyph& glyph, unsigned char* out);
+
+    // 把一个字形的点阵混合到屏幕上，(pen_x, baseline) 为笔位置
+    void draw_glyph(Lcd& screen, const Glyph& glyph, int pen_x, int baseline, uint32_t color);
+
+    // 点阵字体：校验文件并选出与 font_size_ 相同的那一档字号
+    void init_baked();
+
+    // 点阵内存池：按块分配，已经分出去的地址永不移动
+    unsigned char* alloc_bitmap(size_t size);
+
+    std::shared_ptr<FontFile> font_file_;    // 映射到内存的整个字体文件 (多个 Font 共享)
+    const BakedFace* baked_face_ = nullptr;  // 非空表示这是一个 .gbf 点阵字体
+    std::shared_ptr<SdfAtlas> sdf_atlas_;    // 非空表示 GlyphMode::SDF
     stbtt_fontinfo font_info_;               // stb 内部数据结构
+    uint32_t id_;
     float font_size_;
     float scale_;
     int ascent_;
     int descent_;
     int line_gap_;
 
-    // 内部工具：从 UTF-8 字符串中解析出一个完整的 Unicode 码位
-    int decode_utf8(const std::string& text, size_t& offset);
+    // 字形缓存：同一个字 (同一亚像素档) 只光栅化一次，点阵集中放在按块分配的内存池里
+    // 键为 codepoint * kSubpixelSteps + subpixel
+    static constexpr size_t kArenaBlockSize = 64 * 1024;
+    std::unordered_map<int, Glyph> glyph_cache_;
+    std::vector<std::unique_ptr<unsigned char[]>> arena_blocks_;
+    unsigned char* arena_current_ = nullptr;     // 正在切分的小块
+    size_t arena_block_used_ = 0;
+    size_t arena_bytes_ = 0;
+
+    // 码位 -> 字形索引的直接映射缓存：槽位为 codepoint % kGlyphIndexCacheSize，冲突时直接覆盖
+    static constexpr int kGlyphIndexCacheSize = 1024;
+    struct GlyphIndexEntry {
+        int codepoint = -1;
+        GlyphRef ref{nullptr, -1};
+    };
+    std::vector<GlyphIndexEntry> glyph_index_cache_{kGlyphIndexCacheSize};
+    std::vector<Font*> fallbacks_;
+
+    // 字偶距缓存：键为 (left << 32) | right，只登记实际出现过的字对
+    // 字体里根本没有 kern/GPOS 表时 has_kerning_ 为 false，整个查询直接跳过
+    bool has_kerning_ = false;
+    std::unordered_map<uint64_t, float> kern_cache_;
+
+    // 排版缓存：键为 文本 + '\0' + 宽度 + 对齐方式
+    static constexpr size_t kMaxCachedLayouts = 256;
+    std::unordered_map<std::string, std::shared_ptr<const TextLayout>> layout_cache_;
+
+    size_t cache_hits_ = 0;
+    size_t cache_misses_ = 0;
+
+    // 字形、码位解析、字偶距缓存和内存池的锁 (主线程绘制与后台预热线程共用)
+    mutable std::mutex cache_mutex_;
+
+    // 后台预热线程与进度
+    void warmup_worker(std::vector<uint32_t> codepoints, size_t memory_cap);
+    size_t memory_usage() const;        // 本字体的点阵内存池 + SDF 图集
+    size_t chain_memory_usage() const;  // 再加上各个后备字体的
+    std::thread warmup_thread_;
+    std::atomic<bool> warmup_stop_{false};
+    std::atomic<bool> warmup_finished_{true};
+    std::atomic<size_t> warmup_done_{0};
+    std::atomic<size_t> warmup_total_{0};
+
+    // SDF 采样：距离值 (0~255) -> 覆盖率的查找表，只在缩放比例变化时重算
+    std::vector<unsigned char> sdf_scratch_;
+    float sdf_ramp_ratio_ = 0.0f;
+    unsigned char sdf_ramp_[256];
+
+    // 排版时的码位缓冲区：每段文字只解码一次，反复使用同一块内存
+    std::vector<uint32_t> codepoints_;
 };
\ No newline at end of file
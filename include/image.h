@@ -4,13 +4,14 @@
 #include <cstdint>
 #include <string>
 #include <unordered_map>
+#include <vector>
 #include "../include/lcd.h"
 
 // 图像数据类 (纯数据载体)
 class Image {
 public:
     explicit Image(const std::string& file_path);
-    ~Image();
+    ~Image() = default;
 
     // 禁用拷贝，防止指针二次释放
     Image(const Image&) = delete;
@@ -19,17 +20,46 @@ public:
     int get_width() const { return width_; }
     int get_height() const { return height_; }
     
+    bool is_opaque() const { return is_opaque_; }
+
     // 将当前图像画到屏幕上
     void draw(Lcd& screen, int start_x = 0, int start_y = 0);
 
 private:
+    // 生成显存原生格式的像素行 (第一次画到某种格式的屏幕上时调用，结果缓存)
+    // 转换完成后 argb_ 随即释放，图片只保留一份原生像素
+    void prepare(PixelFormat format);
+
+    // 屏幕格式中途改变时用旧的原生像素还原出 argb_ (从 RGB565 还原会损失低位)
+    void restore_argb();
+
+    // 带透明度的图片在加载时预先切段 (见 runs_)，半透明段的像素另存到 blend_argb_
+    void build_runs();
+
+    // 一行中连续同类像素组成的段：透明段不记录，不透明段 memcpy，半透明段做混合
+    enum class RunType : uint8_t { SKIP, COPY, BLEND };
+    struct Run {
+        RunType type;
+        int x;       // 段在行内的起始列
+        int length;
+        int blend;   // BLEND 段的像素在 blend_argb_ 里的起点
+    };
+
     int width_;
     int height_;
     int bit_count_;
-    size_t data_size_;
-    int row_bytes_;
-    bool is_bottom_up_;     // 记录图片是否是倒置存储
-    unsigned char* pixel_data_;
+    bool is_opaque_;                // 没有任何非满 Alpha 的像素：可以整行拷贝
+
+    std::vector<uint32_t> argb_;    // 加载时解码好的自顶向下 0xAARRGGBB 像素，prepare 之后释放
+    std::vector<uint32_t> blend_argb_; // 只有半透明段的 ARGB 像素，首尾相接存放
+
+    PixelFormat native_format_;
+    bool native_ready_;
+    int native_stride_;             // 原生像素每行字节数 = width_ * bpp
+    std::vector<uint8_t> native_;   // 自顶向下、与显存同格式的像素，可直接 memcpy
+
+    std::vector<Run> runs_;         // 所有行的段首尾相接存放
+    std::vector<size_t> row_runs_;  // 第 y 行的段为 runs_[row_runs_[y], row_runs_[y + 1])
 };
 
 // 图像管理器 (全局单例 - 享元模式)
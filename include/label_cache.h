@@ -0,0 +1,50 @@
+// include/label_cache.h
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "../include/lcd.h"
+#include "../include/font.h"
+
+// 静态文字标签的渲染缓存 (全局单例)
+// 一个 (文本, 字体, 字号, 排版参数) 只光栅化一次，生成整段文字的覆盖率位图，
+// 之后每次绘制只是一次 Lcd::blend_mask。按最近最少使用 (LRU) 淘汰，总内存不超过预算。
+class LabelCache {
+public:
+    static LabelCache& get_instance();
+
+    LabelCache(const LabelCache&) = delete;
+    LabelCache& operator=(const LabelCache&) = delete;
+
+    // 参数含义与 Font::layout_text / Font::draw_layout 相同，(x, y) 为文字块左上角
+    void draw(Lcd& screen, Font& font, const std::string& text, int x, int y, uint32_t color,
+              int max_width = 0, TextAlign align = TextAlign::LEFT);
+
+    // 内存预算 (字节)，缩小预算会立即淘汰多出来的标签
+    void set_budget(size_t bytes);
+    size_t get_memory_usage() const { return memory_usage_; }
+
+    void clear_cache();
+
+private:
+    LabelCache() = default;
+
+    struct Label {
+        std::string key;
+        Rect ink;                         // 位图相对文字块左上角的位置与尺寸
+        std::vector<unsigned char> mask;  // 8 位覆盖率，每行 ink.width 字节
+    };
+
+    void evict_to_budget();
+
+    static constexpr size_t kDefaultBudget = 1024 * 1024;
+    size_t budget_ = kDefaultBudget;
+    size_t memory_usage_ = 0;
+
+    // LRU：链表头部是最近用过的，哈希表指向链表节点
+    std::list<Label> lru_;
+    std::unordered_map<std::string, std::list<Label>::iterator> index_;
+};
@@ -3,8 +3,29 @@
 
 #include <cstdint>
 #include <string>
+#include <vector>
+#include <linux/fb.h>
+#include "../include/pixel_format.h"
 
+// 以这个前缀开头的路径不打开设备，而是渲染到一块普通内存里 (x86 上测试/性能分析用)
+// 格式："headless:<宽>x<高>[x<bpp>]"，例如 "headless:800x480x16"
+constexpr char kHeadlessLcdPrefix[] = "headless:";
+
+// 编译期切换：-DGOMOKU_HEADLESS=ON 时默认就用内存后端
+// 运行期切换：设置环境变量 GOMOKU_LCD 覆盖默认路径
+#ifdef GOMOKU_HEADLESS
+constexpr char kDefaultLcdPath[] = "headless:800x480";
+#else
 constexpr char kDefaultLcdPath[] = "/dev/fb0";
+#endif
+
+// 屏幕上的一块矩形区域 (脏矩形追踪用)
+struct Rect {
+    int x;
+    int y;
+    int width;
+    int height;
+};
 
 class Lcd {
 public:
@@ -17,24 +38,124 @@ public:
 
     void render_pixel(int x, int y, uint32_t color);
     void show();
-    void render_circle(int radius, int x, int y, uint32_t color);
+    // anti_aliased 为 true 时边缘按覆盖率做 Alpha 混合，棋子更圆润
+    void render_circle(int radius, int x, int y, uint32_t color, bool anti_aliased = false);
     void render_rectangle(int width, int height, int x, int y, uint32_t color);
     void clear(uint32_t color);
 
+    // 实心填充的核心：整块只裁剪一次，然后按行做宽存储 (NEON 可用时走向量指令)
+    // render_rectangle / clear 以及圆形的扫描线都建立在它之上
+    void fill_rect(Rect rect, uint32_t color);
+    void fill_span(int x, int y, int length, uint32_t color);
+
+    // 贴图：pixels 已经是显存原生格式 (get_format())，每行 src_stride 字节
+    // 自动裁剪并登记脏区，每行一次 memcpy
+    void blit(int x, int y, int width, int height, const uint8_t* pixels, int src_stride);
+
+    // 把一行 0xAARRGGBB 像素按各自的 Alpha 叠加到屏幕上 (source over)
+    void blend_span(int x, int y, const uint32_t* argb, int count);
+
+    // 用纯色 color 按 8 位覆盖率 mask 混合一块区域 (文字点阵)，每行 mask_stride 字节
+    // 与 blend_span 共用同一套按行的混合内核：整块只裁剪一次，NEON 可用时 8 像素一组
+    void blend_mask(int x, int y, int width, int height, const uint8_t* mask, int mask_stride, uint32_t color);
+
     // 新增：对外提供获取屏幕真实分辨率的接口
     int get_width() const { return screen_width_; }
     int get_height() const { return screen_height_; }
 
     uint32_t get_pixel(int x, int y) const;
 
+    // 显存的原生像素格式与每行字节数 (line_length，可能大于 width * bpp)
+    PixelFormat get_format() const { return format_; }
+    int get_bytes_per_pixel() const { return bytes_per_pixel_; }
+    int get_stride() const { return stride_; }
+
+    // 翻页模式下是否在 show() 中等待垂直同步 (驱动不支持时自动关闭)
+    void set_vsync(bool enable) { vsync_ = enable; }
+    bool is_page_flipping() const { return page_flip_; }
+
+    // 把当前显示的画面保存为 PPM 图片 (真机和内存后端都可用)
+    void save_ppm(const std::string& path) const;
+
+    // 内存后端：每次 show() 都把画面依次存为 dir/frame_00000.ppm ...
+    // 也可以用环境变量 GOMOKU_LCD_DUMP 指定目录；传空字符串关闭
+    void set_frame_dump_dir(const std::string& dir) { frame_dump_dir_ = dir; }
+    bool is_headless() const { return headless_; }
+
+    // 脏矩形：标记一块区域已被修改，show() 只会拷贝被标记过的区域
+    // 大块绘制 (图片、文字) 可以先整体标记包围盒，之后的逐像素写入就不必再逐个登记
+    void mark_dirty(int x, int y, int width, int height);
+
 private:
     explicit Lcd(const std::string& dev_path);
+
+    // 内存后端的初始化，spec 为去掉前缀后的 "<宽>x<高>[x<bpp>]"
+    void init_headless(const std::string& spec);
+
+    // 把矩形裁剪到屏幕范围内，完全在屏幕外时返回 false
+    bool clip_rect(Rect& rect) const;
+
+    // 将一块区域并入脏矩形列表 (会裁剪到屏幕内并尝试合并相邻/重叠的矩形)
+    void add_damage(Rect rect);
+
+    // 按矩形列表逐行从 src 拷贝到 dst (两者布局与屏幕一致)
+    void copy_rects(uint8_t* dst, const uint8_t* src, const std::vector<Rect>& rects) const;
+
+    // 写入一个已编码好的原生像素 (带越界保护和脏矩形登记)
+    template <typename Format>
+    void put_pixel(int x, int y, uint32_t native);
+
+    // 以下两个只做裁剪不登记脏区，调用方需事先登记整体包围盒
+    template <typename Format>
+    void fill_span_clipped(int x0, int x1, int y, uint32_t native);
+    template <typename Format>
+    void blend_pixel_clipped(int x, int y, uint32_t color, int alpha);
+
+    void render_circle_smooth(int radius, int x, int y, uint32_t color);
+
+    uint8_t* back_pixel_ptr(int x, int y) const {
+        return back_lptr_ + static_cast<size_t>(stride_) * y + x * bytes_per_pixel_;
+    }
+
+    // 翻页模式：把上一帧的改动同步到新的后台页，使其与正在显示的页一致
+    void sync_back_page();
+
+    // 翻页失败时退回到堆内存双缓冲 + memcpy 的方式
+    void fallback_to_memcpy();
     
     int dev_fd_;
-    int* lptr_;
-    int* back_lptr_;
+    uint8_t* lptr_;        // mmap 得到的显存首地址 (翻页模式下包含两页)
+    uint8_t* back_lptr_;   // 当前绘制目标：堆内存后台缓冲区，或显存中的离屏页
+    uint8_t* front_lptr_;  // 正在显示的那一页
+    size_t map_size_;
+    size_t page_size_;     // 一页的字节数 = stride_ * screen_height_
 
     // 新增：用于动态保存底层的真实物理分辨率
     int screen_width_;
     int screen_height_;
+
+    // 像素格式：后台缓冲区与显存保持同一格式，show() 只是纯拷贝
+    PixelFormat format_;
+    int bytes_per_pixel_;
+    int stride_;
+
+    // 翻页 (page flipping) 状态：驱动提供 yres_virtual >= 2 * yres 时启用
+    struct fb_var_screeninfo vinfo_;
+    bool page_flip_;
+    bool vsync_;
+    int back_page_;    // 后台页的编号 (0 或 1)
+
+    // 自上次 show() 以来被修改过的区域，数量上限为 kMaxDamageRects
+    static constexpr size_t kMaxDamageRects = 16;
+    std::vector<Rect> damage_;
+
+    // 翻页后新的后台页停留在上上帧，需要补上上一帧的改动 (prev_damage_)
+    // 同步推迟到翻页后的第一次绘制：若第一笔就是整屏覆盖则完全省掉这次拷贝
+    std::vector<Rect> prev_damage_;
+    bool sync_pending_;
+
+    // 内存后端：lptr_ 指向冒充显存的堆内存，dev_fd_ 保持 -1
+    bool headless_;
+    std::string frame_dump_dir_;
+    int frame_count_;
 };
\ No newline at end of file
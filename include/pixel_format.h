@@ -0,0 +1,103 @@
+// include/pixel_format.h
+#pragma once
+
+#include <cstdint>
+
+// 显存里像素的实际存储格式 (由 fb_var_screeninfo 的 bpp 和 RGB 位域偏移决定)
+enum class PixelFormat {
+    XRGB8888, // 32bpp，每像素一个 uint32_t
+    RGB888,   // 24bpp，每像素 3 字节 (B, G, R)
+    RGB565,   // 16bpp，每像素一个 uint16_t
+    XBGR8888, // 以下三种与上面对应格式的存储方式相同，只是 R、B 通道位置对调
+    BGR888,   // 24bpp，每像素 3 字节 (R, G, B)
+    BGR565    // 16bpp，蓝色在高 5 位
+};
+
+// 下面每种格式一个 traits 结构体，供模板在编译期特化像素读写：
+//   encode：0xAARRGGBB -> 原生像素值 (每次绘制调用只做一次)
+//   decode：原生像素值 -> 0x00RRGGBB
+//   store / load：在显存地址上读写一个原生像素
+struct Xrgb8888 {
+    static constexpr PixelFormat kFormat = PixelFormat::XRGB8888;
+    static constexpr int kBytesPerPixel = 4;
+
+    static uint32_t encode(uint32_t color) { return color; }
+    static uint32_t decode(uint32_t native) { return native; }
+    static void store(uint8_t* p, uint32_t native) { *reinterpret_cast<uint32_t*>(p) = native; }
+    static uint32_t load(const uint8_t* p) { return *reinterpret_cast<const uint32_t*>(p); }
+};
+
+struct Rgb888 {
+    static constexpr PixelFormat kFormat = PixelFormat::RGB888;
+    static constexpr int kBytesPerPixel = 3;
+
+    static uint32_t encode(uint32_t color) { return color & 0x00FFFFFF; }
+    static uint32_t decode(uint32_t native) { return native; }
+    static void store(uint8_t* p, uint32_t native) {
+        p[0] = native & 0xFF;
+        p[1] = (native >> 8) & 0xFF;
+        p[2] = (native >> 16) & 0xFF;
+    }
+    static uint32_t load(const uint8_t* p) { return p[0] | (p[1] << 8) | (p[2] << 16); }
+};
+
+struct Rgb565 {
+    static constexpr PixelFormat kFormat = PixelFormat::RGB565;
+    static constexpr int kBytesPerPixel = 2;
+
+    static uint32_t encode(uint32_t color) {
+        return ((color >> 8) & 0xF800) | ((color >> 5) & 0x07E0) | ((color >> 3) & 0x001F);
+    }
+    static uint32_t decode(uint32_t native) {
+        // 低位用高位补齐，保证 0x1F 还原成 0xFF 而不是 0xF8
+        uint32_t r = (native >> 11) & 0x1F;
+        uint32_t g = (native >> 5) & 0x3F;
+        uint32_t b = native & 0x1F;
+        return (((r << 3) | (r >> 2)) << 16) | (((g << 2) | (g >> 4)) << 8) | ((b << 3) | (b >> 2));
+    }
+    static void store(uint8_t* p, uint32_t native) { *reinterpret_cast<uint16_t*>(p) = native; }
+    static uint32_t load(const uint8_t* p) { return *reinterpret_cast<const uint16_t*>(p); }
+};
+
+// BGR 系列：存储与 Base 完全一样，编码前 / 解码后把 0xAARRGGBB 的 R、B 对调即可
+template <typename Base, PixelFormat Format>
+struct SwapRB {
+    static constexpr PixelFormat kFormat = Format;
+    static constexpr int kBytesPerPixel = Base::kBytesPerPixel;
+
+    static uint32_t swap(uint32_t color) {
+        return (color & 0xFF00FF00) | ((color >> 16) & 0xFF) | ((color & 0xFF) << 16);
+    }
+    static uint32_t encode(uint32_t color) { return Base::encode(swap(color)); }
+    static uint32_t decode(uint32_t native) { return swap(Base::decode(native)); }
+    static void store(uint8_t* p, uint32_t native) { Base::store(p, native); }
+    static uint32_t load(const uint8_t* p) { return Base::load(p); }
+};
+
+using Xbgr8888 = SwapRB<Xrgb8888, PixelFormat::XBGR8888>;
+using Bgr888 = SwapRB<Rgb888, PixelFormat::BGR888>;
+using Bgr565 = SwapRB<Rgb565, PixelFormat::BGR565>;
+
+inline int bytes_per_pixel(PixelFormat format) {
+    switch (format) {
+        case PixelFormat::RGB565:
+        case PixelFormat::BGR565: return Rgb565::kBytesPerPixel;
+        case PixelFormat::RGB888:
+        case PixelFormat::BGR888: return Rgb888::kBytesPerPixel;
+        default:                  return Xrgb8888::kBytesPerPixel;
+    }
+}
+
+// 运行期格式 -> 编译期 traits 的分发：fn 是一个泛型 lambda，参数类型就是对应的 traits
+// 分支只在每次绘制调用的入口走一次，内层循环里全是编译期确定的读写
+template <typename Fn>
+decltype(auto) dispatch_pixel_format(PixelFormat format, Fn&& fn) {
+    switch (format) {
+        case PixelFormat::RGB565:   return fn(Rgb565{});
+        case PixelFormat::RGB888:   return fn(Rgb888{});
+        case PixelFormat::XBGR8888: return fn(Xbgr8888{});
+        case PixelFormat::BGR888:   return fn(Bgr888{});
+        case PixelFormat::BGR565:   return fn(Bgr565{});
+        default:                    return fn(Xrgb8888{});
+    }
+}
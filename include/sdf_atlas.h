@@ -0,0 +1,51 @@
+// include/sdf_atlas.h
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "stb_truetype.h"
+
+class FontFile;
+
+// 有向距离场 (SDF) 字形图集：每个字只在基准字号下生成一次距离场，
+// 任意字号的 Font (GlyphMode::SDF) 都从这里缩放采样，再按距离做一次阈值/平滑就得到覆盖率。
+// 同一个字体文件的所有字号共享一份图集，不再为每个字号各存一份点阵。
+class SdfAtlas {
+public:
+    // 基准字号与距离场参数：padding 决定了能表达的最大距离，也就决定了能放大/缩小的范围
+    static constexpr float kBaseSize = 48.0f;
+    static constexpr int kPadding = 6;
+    static constexpr int kOnEdge = 128;                          // 轮廓线上的距离值
+    static constexpr float kPixelDistScale = kOnEdge / static_cast<float>(kPadding); // 每基准像素对应的距离值
+
+    // 一个字形的距离场：x0 / y0 为左上角相对 (笔位置, 基线) 的偏移，单位是基准字号下的像素
+    struct SdfGlyph {
+        int x0, y0;
+        int width, height;
+        std::vector<unsigned char> field;
+    };
+
+    // 同一字体文件只生成一个图集，最后一个使用者释放时销毁
+    static std::shared_ptr<SdfAtlas> open(const std::shared_ptr<FontFile>& file);
+
+    SdfAtlas(const SdfAtlas&) = delete;
+    SdfAtlas& operator=(const SdfAtlas&) = delete;
+
+    // 取出距离场，第一次用到时才生成；返回的引用在图集存活期间一直有效 (线程安全)
+    const SdfGlyph& get_glyph(int glyph_index);
+
+    size_t get_memory_usage() const;
+
+private:
+    explicit SdfAtlas(const std::shared_ptr<FontFile>& file);
+
+    std::shared_ptr<FontFile> font_file_;
+    stbtt_fontinfo font_info_;
+    float scale_;
+
+    mutable std::mutex mutex_;
+    std::unordered_map<int, SdfGlyph> glyphs_;
+    size_t memory_usage_ = 0;
+};
@@ -0,0 +1,45 @@
+// include/spsc_queue.h
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+// 无锁的单生产者/单消费者环形队列：一个线程只 push，另一个线程只 pop，全程不加锁、不分配内存
+// Capacity 必须是 2 的幂；下标只增不减，取模用按位与
+template <typename T, size_t Capacity>
+class SpscQueue {
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    // 生产者调用：队列满时返回 false (由调用方决定丢弃还是重试)
+    bool try_push(const T& item) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) == Capacity) {
+            return false;
+        }
+        items_[tail & (Capacity - 1)] = item;
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 消费者调用：队列空时返回 false
+    bool try_pop(T& item) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = items_[head & (Capacity - 1)];
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const {
+        return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+    }
+
+private:
+    // 读写下标分处不同的缓存行，避免两个线程互相抢同一行
+    alignas(64) std::atomic<size_t> head_{0};
+    alignas(64) std::atomic<size_t> tail_{0};
+    T items_[Capacity];
+};
@@ -0,0 +1,78 @@
+// include/utf8.h
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// 带校验的 UTF-8 解码：整段字符串一次解成码位数组，追加到 out 末尾
+// - 绝不会越过 text + length 读取，截断在末尾的多字节序列同样按非法处理
+// - 过长编码、代理区 (U+D800 ~ U+DFFF)、超出 U+10FFFF、孤立的续字节都视为非法，
+//   每段非法字节 (最长的合法前缀) 输出一个 replacement
+// - 纯 ASCII 的片段按 8 字节一组整体判断，不逐字节走分支
+inline void decode_utf8(const char* text, size_t length, std::vector<uint32_t>& out,
+                        uint32_t replacement = 0xFFFD) {
+    const auto* s = reinterpret_cast<const unsigned char*>(text);
+    out.reserve(out.size() + length);
+
+    size_t i = 0;
+    while (i < length) {
+        // ASCII 快速路径：8 个字节的最高位都为 0 时一次放行
+        while (i + 8 <= length) {
+            uint64_t word;
+            memcpy(&word, s + i, sizeof(word));
+            if (word & 0x8080808080808080ULL) break;
+            for (int k = 0; k < 8; ++k) out.push_back(s[i + k]);
+            i += 8;
+        }
+        if (i >= length) break;
+
+        unsigned char c = s[i];
+        if (c < 0x80) {
+            out.push_back(c);
+            ++i;
+            continue;
+        }
+
+        // 首字节决定长度，以及第二个字节的合法范围 (排除过长编码、代理区和超范围码位)
+        int need;
+        uint32_t cp;
+        unsigned char lo = 0x80, hi = 0xBF;
+        if (c >= 0xC2 && c <= 0xDF) {
+            need = 1;
+            cp = c & 0x1F;
+        } else if (c >= 0xE0 && c <= 0xEF) {
+            need = 2;
+            cp = c & 0x0F;
+            if (c == 0xE0) lo = 0xA0;
+            if (c == 0xED) hi = 0x9F;
+        } else if (c >= 0xF0 && c <= 0xF4) {
+            need = 3;
+            cp = c & 0x07;
+            if (c == 0xF0) lo = 0x90;
+            if (c == 0xF4) hi = 0x8F;
+        } else {
+            out.push_back(replacement); // 孤立的续字节或不可能出现的首字节
+            ++i;
+            continue;
+        }
+
+        size_t j = i + 1;
+        int got = 0;
+        while (got < need && j < length && s[j] >= lo && s[j] <= hi) {
+            cp = (cp << 6) | (s[j] & 0x3F);
+            lo = 0x80;
+            hi = 0xBF;
+            ++j;
+            ++got;
+        }
+        out.push_back(got == need ? cp : replacement);
+        i = j;
+    }
+}
+
+inline void decode_utf8(const std::string& text, std::vector<uint32_t>& out, uint32_t replacement = 0xFFFD) {
+    decode_utf8(text.data(), text.size(), out, replacement);
+}
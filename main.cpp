@@ -1,6 +1,10 @@
 #include "include/lcd.h"
 #include "include/ui.h"
 #include "include/font.h"
+#include "include/event.h"
+#include "include/event_loop.h"
+#include <chrono>
+#include <cstdlib>
 #include <exception>
 #include <iostream>
 
@@ -12,6 +16,12 @@ int main() {
         // 加载字体文件（请确保路径下有这个ttf文件）
         Font main_font("SimSun.ttf", 40); 
 
+        // 启动选项：GOMOKU_FONT_WARMUP=digits,ascii,字表文件 时在后台预先光栅化这些字，
+        // 菜单和结算对话框第一次出现时不再现场光栅化 (按钮自己的文字也一并加入)
+        if (const char* warmup = std::getenv("GOMOKU_FONT_WARMUP")) {
+            main_font.start_warmup(Font::load_charset(warmup) + "重新开始");
+        }
+
         // 创建一个按钮
         Button btn(300, 200, 200, 60, "重新开始");
         btn.set_bg_color(0x00336699);   // 蓝色按钮底色
@@ -20,6 +30,29 @@ int main() {
         // 绘制按钮（文字会被优雅地画上去）
         btn.draw(screen, &main_font); 
         screen.show();
+
+        // 事件循环：触摸手势、帧定时器和其它线程投递的任务都在这里分发，UI 线程不会卡在 read 上
+        EventLoop& loop = EventLoop::get_instance();
+        try {
+            // 启动选项：GOMOKU_INPUT_THREAD=1 时由独立线程读触摸屏，主线程卡顿也不会丢事件
+            InputEvent& input = InputEvent::get_instance();
+            if (const char* threaded = std::getenv("GOMOKU_INPUT_THREAD"); threaded && *threaded == '1') {
+                input.start_thread();
+            }
+            input.attach(loop, [&](EventStatus status, const TouchPoint& point) {
+                if (status == EventStatus::TAP) {
+                    btn.check_click(point);
+                }
+            });
+        } catch (std::exception& e) {
+            // 没有触摸屏 (例如在 PC 上用内存后端跑) 时画完这一帧就结束
+            std::cerr << "[Warn] " << e.what() << ", touch input disabled" << std::endl;
+            return 0;
+        }
+
+        // 帧定时器：约 60 fps 把这段时间里画过的区域送显，没有改动时 show() 直接返回
+        loop.add_timer(std::chrono::milliseconds(16), [&] { screen.show(); });
+        loop.run();
     } catch (std::exception& e) {
         std::cerr << e.what() << '\n';
     }
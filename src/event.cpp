@@ -1,25 +1,46 @@
 // src/event.cpp
 #include "../include/event.h"
 #include "../include/lcd.h"  // 【新增】：引入 Lcd 单例以获取真实屏幕分辨率
+#include "../include/event_loop.h"
+#include <algorithm>
 #include <stdexcept>
 #include <unistd.h>
+#include <cerrno>
 #include <cstring>
 #include <fcntl.h>
 #include <iostream>
-#include <chrono>
+#include <ctime>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/stat.h>
 #include <sys/ioctl.h> // 确保包含了 ioctl 的头文件
 
 InputEvent::InputEvent(const std::string& dev_path) 
-    : dev_fd_(-1), touch_max_x_(0), touch_max_y_(0) { 
+    : dev_fd_(-1), event_head_(0), event_tail_(0), current_{}, point_updated_(false), dropping_(false),
+      current_slot_(0), slot_count_(kMaxTouchContacts), contact_seq_(0), has_single_axes_(false), palm_touch_major_(0),
+      notify_fd_(-1), stop_fd_(-1), dropped_points_(0), device_lost_(false),
+      gesture_active_(false), gesture_multi_(false), gesture_start_{},
+      touch_max_x_(0), touch_max_y_(0), screen_width_(0), screen_height_(0) { 
     
-    dev_fd_ = open(dev_path.c_str(), O_RDONLY); 
+    // 非阻塞打开：没有触摸时 read 立即返回，UI 线程由 epoll / poll 负责等待
+    dev_fd_ = open(dev_path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC); 
     if (dev_fd_ < 0) {
         throw std::runtime_error("InputEvent open failed: " + std::string(strerror(errno)));
     }
 
-    // 【动态联动】：获取 LCD 真实分辨率作为 ioctl 失败时的垫底默认值
-    int default_w = Lcd::get_instance().get_width();
-    int default_h = Lcd::get_instance().get_height();
+    // 事件时间戳改用单调时钟：默认的 CLOCK_REALTIME 会被校时打乱，手势时长可能算出负数
+    int clock_id = CLOCK_MONOTONIC;
+    if (ioctl(dev_fd_, EVIOCSCLOCKID, &clock_id) < 0) {
+        std::cerr << "[Warn] EVIOCSCLOCKID failed, event timestamps use the driver default clock" << std::endl;
+    }
+
+    // 【动态联动】：获取 LCD 真实分辨率，既是坐标映射的目标，也是 ioctl 失败时的垫底默认值
+    // 分辨率运行期不会变，记下来，映射坐标时不用每个事件都去问 Lcd
+    screen_width_ = Lcd::get_instance().get_width();
+    screen_height_ = Lcd::get_instance().get_height();
+    int default_w = screen_width_;
+    int default_h = screen_height_;
     touch_max_x_ = default_w;
     touch_max_y_ = default_h;
 
@@ -34,9 +55,22 @@ InputEvent::InputEvent(const std::string& dev_path)
         std::cerr << "[Warn] Could not get absolute axis info, using LCD resolution " 
                   << default_w << "x" << default_h << " as fallback." << std::endl;
     }
+
+    // 多点触摸的槽位数：单点设备没有 ABS_MT_SLOT，就按上限处理 (根本不会用到)
+    struct input_absinfo abs_slot;
+    if (ioctl(dev_fd_, EVIOCGABS(ABS_MT_SLOT), &abs_slot) >= 0 && abs_slot.maximum > 0) {
+        slot_count_ = std::min(abs_slot.maximum + 1, kMaxTouchContacts);
+    }
+
+    // 手掌阈值：接触面长轴超过量程的一半 (手指一般只占很小一部分)
+    struct input_absinfo abs_major;
+    if (ioctl(dev_fd_, EVIOCGABS(ABS_MT_TOUCH_MAJOR), &abs_major) >= 0 && abs_major.maximum > 0) {
+        palm_touch_major_ = std::max(1, abs_major.maximum / 2);
+    }
 }
 
 InputEvent::~InputEvent() {
+    stop_thread();
     if (dev_fd_ >= 0) {
         close(dev_fd_);
     }
@@ -48,37 +82,211 @@ InputEvent& InputEvent::get_instance(const std::string& dev_path) {
 }
 
 bool InputEvent::read_raw_event(struct input_event& ev) {
-    int ret = read(dev_fd_, &ev, sizeof(struct input_event));
-    return ret == sizeof(struct input_event);
+    if (event_head_ == event_tail_) {
+        if (device_lost_) return false;
+
+        // 缓冲区已经消化完：从头开始，一次 read 把内核里攒下的事件尽量都拿过来
+        // (evdev 保证只返回完整的 input_event)
+        ssize_t ret = read(dev_fd_, event_buffer_, sizeof(event_buffer_));
+        if (ret < 0 && (errno == EAGAIN || errno == EINTR)) {
+            return false; // 暂时没有数据
+        }
+        if (ret < static_cast<ssize_t>(sizeof(struct input_event))) {
+            // 读到文件末尾 (回放的事件文件读完、管道写端关闭) 或设备出错 (拔掉后是 ENODEV)：
+            // 以后不会再有事件，记下来让等待它的地方收手，而不是一直空转
+            if (ret < 0) {
+                std::cerr << "[Warn] Touch device read failed: " << strerror(errno) << std::endl;
+            } else {
+                std::cout << "[Info] Touch input reached end of file" << std::endl;
+            }
+            device_lost_ = true;
+            return false;
+        }
+        event_head_ = 0;
+        event_tail_ = static_cast<int>(ret / sizeof(struct input_event));
+    }
+    ev = event_buffer_[event_head_++];
+    return true;
+}
+
+int InputEvent::map_x(int raw) const {
+    // 等比例映射到 LCD 宽度上
+    return (raw * screen_width_) / touch_max_x_;
+}
+
+int InputEvent::map_y(int raw) const {
+    return (raw * screen_height_) / touch_max_y_;
+}
+
+void InputEvent::resync_state() {
+    struct input_absinfo abs;
+    int code_x = has_single_axes_ ? ABS_X : ABS_MT_POSITION_X;
+    int code_y = has_single_axes_ ? ABS_Y : ABS_MT_POSITION_Y;
+    if (ioctl(dev_fd_, EVIOCGABS(code_x), &abs) >= 0) {
+        current_.x = map_x(abs.value);
+    }
+    if (ioctl(dev_fd_, EVIOCGABS(code_y), &abs) >= 0) {
+        current_.y = map_y(abs.value);
+    }
+    if (ioctl(dev_fd_, EVIOCGABS(ABS_MT_SLOT), &abs) >= 0) {
+        current_slot_ = (abs.value >= 0 && abs.value < slot_count_) ? abs.value : -1;
+    }
+
+    // 触点表：一次 ioctl 取回所有槽位的某一项；拿不到跟踪编号就保持原表
+    struct {
+        uint32_t code;
+        int32_t values[kMaxTouchContacts];
+    } mt;
+    auto fetch_slots = [&](uint32_t code) {
+        mt.code = code;
+        return ioctl(dev_fd_, EVIOCGMTSLOTS(sizeof(mt)), &mt) >= 0;
+    };
+    if (fetch_slots(ABS_MT_TRACKING_ID)) {
+        for (int i = 0; i < slot_count_; ++i) {
+            ContactSlot& slot = slots_[i];
+            int id = mt.values[i];
+            if (id >= 0 && id != slot.tracking_id) slot.down_seq = ++contact_seq_;
+            slot.tracking_id = id < 0 ? -1 : id;
+        }
+        if (fetch_slots(ABS_MT_POSITION_X)) {
+            for (int i = 0; i < slot_count_; ++i) slots_[i].x = map_x(mt.values[i]);
+        }
+        if (fetch_slots(ABS_MT_POSITION_Y)) {
+            for (int i = 0; i < slot_count_; ++i) slots_[i].y = map_y(mt.values[i]);
+        }
+        if (fetch_slots(ABS_MT_TOUCH_MAJOR)) {
+            for (int i = 0; i < slot_count_; ++i) slots_[i].touch_major = mt.values[i];
+        }
+#ifdef MT_TOOL_PALM
+        if (fetch_slots(ABS_MT_TOOL_TYPE)) {
+            for (int i = 0; i < slot_count_; ++i) slots_[i].is_palm = (mt.values[i] == MT_TOOL_PALM);
+        }
+#endif
+    }
+
+    unsigned char keys[KEY_MAX / 8 + 1];
+    memset(keys, 0, sizeof(keys));
+    if (ioctl(dev_fd_, EVIOCGKEY(sizeof(keys)), keys) >= 0) {
+        current_.is_pressed = (keys[BTN_TOUCH / 8] >> (BTN_TOUCH % 8)) & 1;
+    }
+}
+
+void InputEvent::publish_contacts() {
+    int count = 0;
+    int palms = 0;
+    const ContactSlot* primary = nullptr;
+    for (int i = 0; i < slot_count_; ++i) {
+        const ContactSlot& slot = slots_[i];
+        if (slot.tracking_id < 0) continue;
+        bool palm = slot.is_palm || (palm_touch_major_ > 0 && slot.touch_major >= palm_touch_major_);
+        current_.contacts[count++] = TouchContact{slot.tracking_id, slot.x, slot.y, slot.touch_major, palm};
+        if (palm) {
+            ++palms;
+            continue;
+        }
+        if (primary == nullptr || slot.down_seq < primary->down_seq) primary = &slot;
+    }
+    current_.contact_count = count;
+
+    // 有触点时按下状态看手指：只有手掌压着相当于没有按下 (BTN_TOUCH 只反映"有东西碰着屏幕")
+    // 这样手掌搭着时另一根手指的点击照常识别，手掌本身放下/抬起也不会被当成一次点击
+    if (count > 0) {
+        current_.is_pressed = palms < count;
+    }
+
+    // 主触点跟着最早按下的那根手指走 (手掌除外)，另一根手指不会让坐标来回跳
+    // 有单点坐标的设备平时直接用 ABS_X / ABS_Y；但内核模拟的单点可能正跟着手掌，有手掌时改用手指的坐标
+    if (primary != nullptr && (!has_single_axes_ || palms > 0)) {
+        current_.x = primary->x;
+        current_.y = primary->y;
+    }
 }
 
 // 核心解析逻辑：从碎片化的输入事件中拼凑出一个完整的触摸点
+// ABS_X / ABS_Y 是驱动给出的单点坐标；ABS_MT_* 按 ABS_MT_SLOT 选中的槽位写进触点表，
+// 不再和单点坐标混在一起 (否则两根手指时坐标会在两者之间来回跳)
 bool InputEvent::get_touch_point(TouchPoint& point) {
     struct input_event ev;
-    bool point_updated = false;
-
-    // 【动态联动】：每次映射坐标前，获取当前 LCD 的真实分辨率
-    int screen_w = Lcd::get_instance().get_width();
-    int screen_h = Lcd::get_instance().get_height();
 
     while (read_raw_event(ev)) {
+        // 内核缓冲区溢出过：丢掉直到下一个 SYN_REPORT 为止的残缺事件，
+        // 然后直接向驱动查询当前状态，当作这一刻的一帧交出去 (丢失的抬起也能补上，手势不会卡住)
+        if (ev.type == EV_SYN && ev.code == SYN_DROPPED) {
+            dropping_ = true;
+            continue;
+        }
+        if (dropping_) {
+            if (ev.type == EV_SYN && ev.code == SYN_REPORT) {
+                dropping_ = false;
+                resync_state();
+                point_updated_ = true;
+            } else {
+                continue;
+            }
+        }
+
         if (ev.type == EV_ABS) { 
-            if (ev.code == ABS_X || ev.code == ABS_MT_POSITION_X) {
+            if (ev.code == ABS_X) {
                 // 等比例映射：把物理坐标映射到真实的 LCD 宽度上
-                point.x = (ev.value * screen_w) / touch_max_x_;
-                point_updated = true;
-            } else if (ev.code == ABS_Y || ev.code == ABS_MT_POSITION_Y) {
+                has_single_axes_ = true;
+                current_.x = map_x(ev.value);
+                point_updated_ = true;
+            } else if (ev.code == ABS_Y) {
                 // 等比例映射：把物理坐标映射到真实的 LCD 高度上
-                point.y = (ev.value * screen_h) / touch_max_y_;
-                point_updated = true;
+                has_single_axes_ = true;
+                current_.y = map_y(ev.value);
+                point_updated_ = true;
+            } else if (ev.code == ABS_MT_SLOT) {
+                current_slot_ = (ev.value >= 0 && ev.value < slot_count_) ? ev.value : -1;
+            } else if (current_slot_ >= 0) {
+                ContactSlot& slot = slots_[current_slot_];
+                switch (ev.code) {
+                case ABS_MT_TRACKING_ID:
+                    if (ev.value < 0) {
+                        slot.tracking_id = -1;
+                    } else {
+                        // 新手指沿用槽位里的旧坐标：内核会过滤掉与槽位旧值相同的事件，不会重发
+                        if (slot.tracking_id < 0) slot.down_seq = ++contact_seq_;
+                        slot.tracking_id = ev.value;
+                    }
+                    break;
+                case ABS_MT_POSITION_X:
+                    slot.x = map_x(ev.value);
+                    // 没有跟踪编号的老式设备 (协议 A)：照旧直接当作单点坐标
+                    if (!has_single_axes_ && slot.tracking_id < 0) current_.x = slot.x;
+                    break;
+                case ABS_MT_POSITION_Y:
+                    slot.y = map_y(ev.value);
+                    if (!has_single_axes_ && slot.tracking_id < 0) current_.y = slot.y;
+                    break;
+                case ABS_MT_TOUCH_MAJOR:
+                    slot.touch_major = ev.value;
+                    break;
+#ifdef MT_TOOL_PALM
+                case ABS_MT_TOOL_TYPE:
+                    slot.is_palm = (ev.value == MT_TOOL_PALM);
+                    break;
+#endif
+                default:
+                    continue;
+                }
+                point_updated_ = true;
             }
         } else if (ev.type == EV_KEY) { 
             if (ev.code == BTN_TOUCH) {
-                point.is_pressed = (ev.value > 0);
-                point_updated = true;
+                current_.is_pressed = (ev.value > 0);
+                point_updated_ = true;
             }
-        } else if (ev.type == EV_SYN) { 
-            if (point_updated) {
+        } else if (ev.type == EV_SYN && ev.code == SYN_REPORT) { 
+            if (point_updated_) {
+                point_updated_ = false;
+                publish_contacts();
+#ifdef input_event_sec
+                current_.time_us = static_cast<int64_t>(ev.input_event_sec) * 1000000 + ev.input_event_usec;
+#else
+                current_.time_us = static_cast<int64_t>(ev.time.tv_sec) * 1000000 + ev.time.tv_usec;
+#endif
+                point = current_;
                 return true; 
             }
         }
@@ -102,23 +310,148 @@ TouchPoint operator-(const TouchPoint& other1, const TouchPoint& other2) {
     return new_point;
 }
 
+void InputEvent::start_thread() {
+    if (is_threaded()) return;
+    notify_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    stop_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (notify_fd_ < 0 || stop_fd_ < 0) {
+        throw std::runtime_error("InputEvent eventfd failed: " + std::string(strerror(errno)));
+    }
+    input_thread_ = std::thread(&InputEvent::input_thread_main, this);
+}
+
+void InputEvent::stop_thread() {
+    if (!is_threaded()) return;
+    uint64_t one = 1;
+    (void)!write(stop_fd_, &one, sizeof(one));
+    input_thread_.join();
+    close(stop_fd_);
+    close(notify_fd_);
+    stop_fd_ = notify_fd_ = -1;
+}
+
+void InputEvent::input_thread_main() {
+    struct pollfd fds[2] = {{dev_fd_, POLLIN, 0}, {stop_fd_, POLLIN, 0}};
+    for (;;) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "[Warn] Input thread poll failed: " << strerror(errno) << std::endl;
+            return;
+        }
+        if (fds[1].revents) return;
+        bool hung_up = fds[0].revents & (POLLERR | POLLHUP | POLLNVAL);
+
+        // 一口气把已到达的事件都拼成触摸点放进队列，再统一唤醒 UI 线程一次
+        TouchPoint point;
+        bool published = false;
+        while (get_touch_point(point)) {
+            if (touch_queue_.try_push(point)) {
+                published = true;
+            } else {
+                ++dropped_points_;
+            }
+        }
+        // 设备没了：最后的点已经在队列里，置位后再通知一次，UI 线程取完就会把它摘掉
+        if (hung_up) device_lost_ = true;
+        if (published || device_lost_) {
+            uint64_t one = 1;
+            (void)!write(notify_fd_, &one, sizeof(one));
+        }
+        if (device_lost_) {
+            std::cerr << "[Warn] Touch device lost, input thread exits" << std::endl;
+            return;
+        }
+    }
+}
+
+void InputEvent::drain_notify() {
+    uint64_t count;
+    while (read(notify_fd_, &count, sizeof(count)) == sizeof(count)) {}
+}
+
+bool InputEvent::pop_touch_point(TouchPoint& point) {
+    return is_threaded() ? touch_queue_.try_pop(point) : get_touch_point(point);
+}
+
+bool InputEvent::poll_gesture(EventStatus& status, TouchPoint& out_point) {
+    TouchPoint point;
+    while (pop_touch_point(point)) {
+        if (point.is_pressed && !gesture_active_) {
+            // 1. 捕获按下瞬间
+            gesture_active_ = true;
+            gesture_multi_ = false;
+            gesture_start_ = point;
+        }
+        if (gesture_active_ && !gesture_multi_) {
+            // 手掌只是搭在屏幕上，不算第二根手指
+            int fingers = 0;
+            for (int i = 0; i < point.contact_count; ++i) {
+                if (!point.contacts[i].is_palm) ++fingers;
+            }
+            gesture_multi_ = fingers > 1;
+        }
+        if (!point.is_pressed && gesture_active_) {
+            // 2. 捕获抬起瞬间：时长取两帧的内核时间戳之差，读得晚了也不会把滑动算成超时
+            gesture_active_ = false;
+            long duration = static_cast<long>((point.time_us - gesture_start_.time_us) / 1000);
+            status = gesture_multi_ ? EventStatus::NONE : classify(gesture_start_, point, duration, out_point);
+            return true;
+        }
+    }
+    return false;
+}
+
 EventStatus InputEvent::get_current_status(TouchPoint& out_point) {
-    TouchPoint start_point, end_point;
-    
-    // 1. 捕获按下瞬间
-    while (get_touch_point(start_point)) {
-        if (start_point.is_pressed) break;
+    EventStatus status;
+    bool hung_up = false;
+    for (;;) {
+        // 先读标志再取点：输入线程置位之前推进队列的点，这一轮一定取得到
+        bool lost = device_lost_;
+        if (poll_gesture(status, out_point)) return status;
+        if (lost || hung_up) return EventStatus::NONE; // 设备拔掉或回放读完，不会再有手势了
+
+        struct pollfd pfd = {get_fd(), POLLIN, 0};
+        if (poll(&pfd, 1, -1) < 0 && errno != EINTR) {
+            return EventStatus::NONE;
+        }
+        hung_up = pfd.revents & (POLLERR | POLLHUP | POLLNVAL);
+        if (is_threaded()) drain_notify();
     }
-    auto start_time = std::chrono::steady_clock::now();
+}
 
-    // 2. 捕获抬起瞬间
-    while (get_touch_point(end_point)) {
-        if (!end_point.is_pressed) break;
+void InputEvent::attach(EventLoop& loop, GestureHandler handler) {
+    // 普通文件 (回放录下的事件) 不能交给 epoll，而且随时可读：投递一个任务一口气回放完
+    struct stat st;
+    if (!is_threaded() && fstat(dev_fd_, &st) == 0 && S_ISREG(st.st_mode)) {
+        loop.post([this, handler = std::move(handler)] {
+            EventStatus status;
+            TouchPoint point{};
+            while (poll_gesture(status, point)) {
+                handler(status, point);
+            }
+        });
+        return;
     }
-    auto end_time = std::chrono::steady_clock::now();
 
-    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count();
+    loop.add_fd(get_fd(), EPOLLIN, [this, &loop, handler = std::move(handler)](uint32_t events) {
+        if (is_threaded()) drain_notify(); // 先清通知再取队列，之后新到的点会重新触发
+        bool lost = device_lost_;
+        EventStatus status;
+        TouchPoint point{};
+        while (poll_gesture(status, point)) {
+            handler(status, point);
+        }
 
+        // 设备拔掉 / 出错 / 读到末尾：fd 会一直处于就绪状态，不摘掉的话 UI 线程会空转
+        if (lost || (events & (EPOLLERR | EPOLLHUP))) {
+            std::cerr << "[Warn] Touch input lost, detached from the event loop" << std::endl;
+            loop.remove_fd(get_fd());
+        }
+    });
+}
+
+EventStatus InputEvent::classify(const TouchPoint& start_point, const TouchPoint& end_point, long duration,
+                                 TouchPoint& out_point) const {
     int dx = end_point.x - start_point.x;
     int dy = end_point.y - start_point.y;
     int abs_dx = std::abs(dx);
@@ -150,4 +483,4 @@ EventStatus InputEvent::get_current_status(TouchPoint& out_point) {
     }
 
     return EventStatus::NONE;
-}
\ No newline at end of file
+}
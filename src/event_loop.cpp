@@ -0,0 +1,138 @@
+// src/event_loop.cpp
+#include "../include/event_loop.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+
+EventLoop& EventLoop::get_instance() {
+    static EventLoop instance;
+    return instance;
+}
+
+EventLoop::EventLoop() : epoll_fd_(-1), wake_fd_(-1), running_(false) {
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd_ < 0) {
+        throw std::runtime_error("epoll_create1 failed: " + std::string(strerror(errno)));
+    }
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wake_fd_ < 0) {
+        close(epoll_fd_);
+        throw std::runtime_error("eventfd failed: " + std::string(strerror(errno)));
+    }
+    add_fd(wake_fd_, EPOLLIN, [this](uint32_t) {
+        uint64_t count;
+        while (read(wake_fd_, &count, sizeof(count)) == sizeof(count)) {}
+        run_posted_tasks();
+    });
+}
+
+EventLoop::~EventLoop() {
+    close(wake_fd_);
+    close(epoll_fd_);
+}
+
+void EventLoop::add_fd(int fd, uint32_t events, FdHandler handler) {
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = events;
+    ev.data.fd = fd;
+
+    int op = handlers_.count(fd) ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+    if (epoll_ctl(epoll_fd_, op, fd, &ev) < 0) {
+        throw std::runtime_error("epoll_ctl failed: " + std::string(strerror(errno)));
+    }
+    handlers_[fd] = std::move(handler);
+}
+
+void EventLoop::remove_fd(int fd) {
+    if (handlers_.erase(fd) > 0) {
+        epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+    }
+}
+
+int EventLoop::add_timer(std::chrono::milliseconds interval, Task callback, bool repeat) {
+    int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (fd < 0) {
+        throw std::runtime_error("timerfd_create failed: " + std::string(strerror(errno)));
+    }
+
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+    long long ms = std::max<long long>(interval.count(), 1); // 全 0 表示关闭定时器
+    spec.it_value.tv_sec = ms / 1000;
+    spec.it_value.tv_nsec = (ms % 1000) * 1000000;
+    if (repeat) {
+        spec.it_interval = spec.it_value;
+    }
+    if (timerfd_settime(fd, 0, &spec, nullptr) < 0) {
+        close(fd);
+        throw std::runtime_error("timerfd_settime failed: " + std::string(strerror(errno)));
+    }
+
+    add_fd(fd, EPOLLIN, [this, fd, repeat, callback = std::move(callback)](uint32_t) {
+        uint64_t expirations;
+        if (read(fd, &expirations, sizeof(expirations)) != sizeof(expirations)) return;
+        if (!repeat) {
+            cancel_timer(fd); // 先注销再回调：回调里可以放心地再建新定时器
+        }
+        callback();
+    });
+    return fd;
+}
+
+void EventLoop::cancel_timer(int timer_id) {
+    if (handlers_.count(timer_id) == 0) return;
+    remove_fd(timer_id);
+    close(timer_id);
+}
+
+void EventLoop::post(Task task) {
+    {
+        std::lock_guard<std::mutex> lock(task_mutex_);
+        tasks_.push_back(std::move(task));
+    }
+    uint64_t one = 1;
+    (void)!write(wake_fd_, &one, sizeof(one));
+}
+
+void EventLoop::run_posted_tasks() {
+    std::vector<Task> tasks;
+    {
+        std::lock_guard<std::mutex> lock(task_mutex_);
+        tasks.swap(tasks_);
+    }
+    for (auto& task : tasks) {
+        task();
+    }
+}
+
+void EventLoop::run() {
+    running_ = true;
+    struct epoll_event events[kMaxEvents];
+    while (running_) {
+        int n = epoll_wait(epoll_fd_, events, kMaxEvents, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error("epoll_wait failed: " + std::string(strerror(errno)));
+        }
+        for (int i = 0; i < n && running_; ++i) {
+            // 回调可能注销自己或别的 fd：每次重新查表，并拷贝一份回调再调用
+            auto it = handlers_.find(events[i].data.fd);
+            if (it == handlers_.end()) continue;
+            FdHandler handler = it->second;
+            handler(events[i].events);
+        }
+    }
+}
+
+void EventLoop::stop() {
+    running_ = false;
+    uint64_t one = 1;
+    (void)!write(wake_fd_, &one, sizeof(one));
+}
@@ -1,28 +1,98 @@
 // src/font.cpp
 #include "../include/font.h"
-#include <fstream>
+#include <algorithm>
+#include <cmath>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <atomic>
+#include <mutex>
 #include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 // ！！！必须只在一个 cpp 文件中定义这个宏，它会把实现代码展开！！！
 #define STB_TRUETYPE_IMPLEMENTATION
 #include "../include/stb_truetype.h"
 
-Font::Font(const std::string& ttf_path, float font_size) : font_size_(font_size) {
-    // 1. 以二进制模式读取整个 TTF 文件到内存
-    std::ifstream file(ttf_path, std::ios::binary | std::ios::ate);
-    if (!file.is_open()) {
-        throw std::runtime_error("Failed to open font file: " + ttf_path);
+// --- FontFile 的实现 ---
+
+std::shared_ptr<FontFile> FontFile::open(const std::string& path) {
+    // 已经映射过的文件直接复用；用 weak_ptr 登记，不会让映射永远驻留
+    static std::mutex registry_mutex;
+    static std::unordered_map<std::string, std::weak_ptr<FontFile>> registry;
+
+    // 用规范化后的绝对路径做键，"./a.ttf" 和 "a.ttf" 是同一个文件
+    char resolved[PATH_MAX];
+    std::string key = realpath(path.c_str(), resolved) ? resolved : path;
+
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    if (auto it = registry.find(key); it != registry.end()) {
+        if (auto file = it->second.lock()) {
+            return file;
+        }
+    }
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open font file: " + path);
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        throw std::runtime_error("Failed to read font data: " + path);
     }
-    std::streamsize size = file.tellg();
-    file.seekg(0, std::ios::beg);
-    
-    font_buffer_.resize(size);
-    if (!file.read(reinterpret_cast<char*>(font_buffer_.data()), size)) {
-        throw std::runtime_error("Failed to read font data");
+
+    size_t size = static_cast<size_t>(st.st_size);
+    void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // 映射建立后 fd 就不再需要了
+    if (data == MAP_FAILED) {
+        throw std::runtime_error("Font mmap failed: " + std::string(strerror(errno)));
+    }
+    // 字形表的访问是随机的，别让内核白白预读一大片
+    madvise(data, size, MADV_RANDOM);
+
+    std::shared_ptr<FontFile> file(new FontFile(static_cast<const unsigned char*>(data), size));
+    registry[key] = file;
+    return file;
+}
+
+FontFile::~FontFile() {
+    munmap(const_cast<unsigned char*>(data_), size_);
+}
+
+// --- Font 的实现 ---
+
+namespace {
+
+// Font 编号发生器：构造时分配一个，渲染结果变了 (加后备字体) 时再换一个
+uint32_t allocate_font_id() {
+    static std::atomic<uint32_t> next_id{1};
+    return next_id++;
+}
+
+} // namespace
+
+Font::Font(const std::string& ttf_path, float font_size, GlyphMode mode) : font_size_(font_size) {
+    id_ = allocate_font_id();
+
+    // 1. 只读映射 TTF 文件 (同一文件的其它字号共用这份映射)
+    font_file_ = FontFile::open(ttf_path);
+
+    // 预烘焙的点阵字体：不需要 stb_truetype，度量和点阵全部直接来自文件
+    if (is_baked_font(font_file_->data(), font_file_->size())) {
+        if (mode == GlyphMode::SDF) {
+            throw std::runtime_error("SDF glyphs need a TrueType font: " + ttf_path);
+        }
+        init_baked();
+        return;
     }
 
     // 2. 初始化 stb_truetype
-    if (!stbtt_InitFont(&font_info_, font_buffer_.data(), 0)) {
+    if (!stbtt_InitFont(&font_info_, font_file_->data(), 0)) {
         throw std::runtime_error("Failed to initialize stb_truetype font info");
     }
 
@@ -31,80 +101,565 @@ Font::Font(const std::string& ttf_path, float font_size) : font_size_(font_size)
     stbtt_GetFontVMetrics(&font_info_, &ascent_, &descent_, &line_gap_);
     ascent_ = ascent_ * scale_;
     descent_ = descent_ * scale_;
+    line_gap_ = line_gap_ * scale_;
+    has_kerning_ = font_info_.kern != 0 || font_info_.gpos != 0;
+
+    // 4. SDF 模式：同一字体文件的所有字号共用一个距离场图集
+    if (mode == GlyphMode::SDF) {
+        sdf_atlas_ = SdfAtlas::open(font_file_);
+    }
 }
 
-// 轻量级 UTF-8 解析器：把中文字符（3字节）转换成 Unicode ID
-int Font::decode_utf8(const std::string& text, size_t& i) {
-    unsigned char c = text[i];
-    if (c <= 0x7F) { // ASCII
-        i += 1; return c;
-    } else if ((c & 0xE0) == 0xC0) { // 2 字节字符
-        int cp = ((c & 0x1F) << 6) | (text[i+1] & 0x3F);
-        i += 2; return cp;
-    } else if ((c & 0xF0) == 0xE0) { // 3 字节字符 (绝大部分中文)
-        int cp = ((c & 0x0F) << 12) | ((text[i+1] & 0x3F) << 6) | (text[i+2] & 0x3F);
-        i += 3; return cp;
-    } else if ((c & 0xF8) == 0xF0) { // 4 字节字符 (Emoji等)
-        int cp = ((c & 0x07) << 18) | ((text[i+1] & 0x3F) << 12) | ((text[i+2] & 0x3F) << 6) | (text[i+3] & 0x3F);
-        i += 4; return cp;
+void Font::init_baked() {
+    const unsigned char* data = font_file_->data();
+    size_t size = font_file_->size();
+
+    // 文件来自磁盘，不能盲信：所有偏移都要落在文件范围内
+    // 一律用 64 位算，32 位 ARM 上 size_t 的乘法和加法会回绕，畸形的计数能骗过检查
+    auto fits = [size](uint64_t offset, uint64_t count, uint64_t elem_size) {
+        return offset <= size && count * elem_size <= size - offset;
+    };
+    const auto* header = reinterpret_cast<const BakedFontHeader*>(data);
+    if (header->version != kBakedFontVersion ||
+        !fits(sizeof(BakedFontHeader), header->face_count, sizeof(BakedFace))) {
+        throw std::runtime_error("Corrupted baked font file");
     }
-    i += 1; return '?'; // 无法识别的乱码
+
+    const auto* faces = reinterpret_cast<const BakedFace*>(data + sizeof(BakedFontHeader));
+    std::string available;
+    for (uint32_t i = 0; i < header->face_count; ++i) {
+        const BakedFace& face = faces[i];
+        available += " " + std::to_string(static_cast<int>(face.pixel_size));
+        if (std::fabs(face.pixel_size - font_size_) > 0.01f) continue;
+
+        // 字形表和字偶距表会被直接当作结构体数组访问 (含 uint32 / float 成员)，偏移必须 4 字节对齐
+        if (face.glyph_offset % 4 != 0 || face.kern_offset % 4 != 0 ||
+            !fits(face.glyph_offset, face.glyph_count, sizeof(BakedGlyph)) ||
+            !fits(face.kern_offset, face.kern_count, sizeof(BakedKernPair)) ||
+            !fits(face.bitmap_offset, face.bitmap_size, 1)) {
+            throw std::runtime_error("Corrupted baked font file");
+        }
+        const auto* glyphs = reinterpret_cast<const BakedGlyph*>(data + face.glyph_offset);
+        for (uint32_t g = 0; g < face.glyph_count; ++g) {
+            uint64_t bitmap_end = static_cast<uint64_t>(glyphs[g].bitmap_offset) +
+                                  static_cast<uint64_t>(glyphs[g].width) * glyphs[g].height;
+            if (bitmap_end > face.bitmap_size) {
+                throw std::runtime_error("Corrupted baked font file");
+            }
+        }
+
+        baked_face_ = &face;
+        scale_ = 0.0f;
+        ascent_ = face.ascent;
+        descent_ = face.descent;
+        line_gap_ = face.line_gap;
+        has_kerning_ = face.kern_count > 0;
+        return;
+    }
+    throw std::runtime_error("Baked font has no size " + std::to_string(font_size_) + ", available:" + available);
 }
 
-void Font::draw_text(Lcd& screen, const std::string& text, int start_x, int start_y, uint32_t color) {
-    // 拆解目标颜色 (0xAARRGGBB)
-    uint8_t fg_r = (color >> 16) & 0xFF;
-    uint8_t fg_g = (color >> 8) & 0xFF;
-    uint8_t fg_b = color & 0xFF;
-
-    int current_x = start_x;
-    // start_y 是文字整体的左上角，但在排版学里画字要基于“基线 (Baseline)”
-    int baseline = start_y + ascent_;
-
-    size_t i = 0;
-    while (i < text.length()) {
-        int codepoint = decode_utf8(text, i);
-
-        // 获取字形的尺寸和偏移
-        int advance_width, left_side_bearing;
-        stbtt_GetCodepointHMetrics(&font_info_, codepoint, &advance_width, &left_side_bearing);
-
-        int x0, y0, x1, y1;
-        stbtt_GetCodepointBitmapBox(&font_info_, codepoint, scale_, scale_, &x0, &y0, &x1, &y1);
-
-        // 渲染成单通道(灰度)的 Alpha 遮罩
-        int w = x1 - x0;
-        int h = y1 - y0;
-        unsigned char* bitmap = stbtt_GetCodepointBitmap(&font_info_, scale_, scale_, codepoint, &w, &h, nullptr, nullptr);
-
-        if (bitmap) {
-            // 将点阵绘制到屏幕
-            for (int r = 0; r < h; ++r) {
-                for (int c = 0; c < w; ++c) {
-                    int alpha = bitmap[r * w + c];
-                    if (alpha == 0) continue; // 完全透明，跳过
-
-                    int draw_x = current_x + x0 + c;
-                    int draw_y = baseline + y0 + r;
-
-                    // 获取屏幕上该点原本的颜色 (背景色)
-                    uint32_t bg_color = screen.get_pixel(draw_x, draw_y);
-                    uint8_t bg_r = (bg_color >> 16) & 0xFF;
-                    uint8_t bg_g = (bg_color >> 8) & 0xFF;
-                    uint8_t bg_b = bg_color & 0xFF;
-
-                    // 【核心算法】：Alpha 混合！实现极其平滑的字体边缘
-                    uint8_t out_r = (fg_r * alpha + bg_r * (255 - alpha)) / 255;
-                    uint8_t out_g = (fg_g * alpha + bg_g * (255 - alpha)) / 255;
-                    uint8_t out_b = (fg_b * alpha + bg_b * (255 - alpha)) / 255;
-
-                    screen.render_pixel(draw_x, draw_y, (out_r << 16) | (out_g << 8) | out_b);
-                }
+int Font::find_glyph_index(int codepoint) const {
+    if (!baked_face_) {
+        int index = stbtt_FindGlyphIndex(&font_info_, codepoint);
+        return index > 0 ? index : -1;
+    }
+
+    // 点阵字体按 codepoint 有序排列，二分查找；字形索引就是数组下标
+    const auto* begin = reinterpret_cast<const BakedGlyph*>(font_file_->data() + baked_face_->glyph_offset);
+    const auto* end = begin + baked_face_->glyph_count;
+    const BakedGlyph* it = std::lower_bound(begin, end, static_cast<uint32_t>(codepoint),
+                                            [](const BakedGlyph& g, uint32_t value) { return g.codepoint < value; });
+    return (it != end && it->codepoint == static_cast<uint32_t>(codepoint)) ? static_cast<int>(it - begin) : -1;
+}
+
+Font::GlyphRef Font::resolve_glyph(int codepoint) {
+    GlyphIndexEntry& entry = glyph_index_cache_[static_cast<uint32_t>(codepoint) % kGlyphIndexCacheSize];
+    if (entry.codepoint == codepoint) {
+        return entry.ref;
+    }
+
+    // 沿后备链找第一个包含这个字的字体；都没有就记为本字体的缺字
+    GlyphRef ref{this, find_glyph_index(codepoint)};
+    for (size_t k = 0; ref.index < 0 && k < fallbacks_.size(); ++k) {
+        if (int index = fallbacks_[k]->find_glyph_index(codepoint); index >= 0) {
+            ref = {fallbacks_[k], index};
+        }
+    }
+    if (ref.index < 0) ref.font = this;
+
+    entry.codepoint = codepoint;
+    entry.ref = ref;
+    return ref;
+}
+
+void Font::add_fallback(Font& fallback) {
+    if (&fallback == this) return;
+    stop_warmup();
+
+    // 别的字体的预热线程可能正通过本字体的 get_glyph 遍历 fallbacks_，修改也要在锁里做
+    std::lock_guard<std::mutex> lock(cache_mutex_);
+    fallbacks_.push_back(&fallback);
+
+    // 以前判定为缺字的码位现在可能有了着落，解析结果和依赖它们的缓存全部作废；
+    // 换一个编号，LabelCache 里按旧编号缓存的标签从此不会再命中，随 LRU 自然淘汰
+    id_ = allocate_font_id();
+    glyph_index_cache_.assign(kGlyphIndexCacheSize, GlyphIndexEntry{});
+    glyph_cache_.clear();
+    kern_cache_.clear();
+    layout_cache_.clear();
+}
+
+Font::Glyph Font::find_baked_glyph(int glyph_index) const {
+    const unsigned char* data = font_file_->data();
+    const auto* glyphs = reinterpret_cast<const BakedGlyph*>(data + baked_face_->glyph_offset);
+
+    // 没烘焙的字先退回 '?'，再没有就当空格
+    if (glyph_index < 0) glyph_index = find_glyph_index('?');
+    if (glyph_index < 0) return {font_size_ / 2, 0, 0, 0, 0, nullptr};
+
+    const BakedGlyph& g = glyphs[glyph_index];
+    return {g.advance, g.x0, g.y0, g.width, g.height, data + baked_face_->bitmap_offset + g.bitmap_offset};
+}
+
+float Font::find_baked_kerning(int left, int right) const {
+    const auto* begin = reinterpret_cast<const BakedKernPair*>(font_file_->data() + baked_face_->kern_offset);
+    const auto* end = begin + baked_face_->kern_count;
+
+    // 按 (left, right) 有序排列，二分查找
+    auto pair = std::make_pair(static_cast<uint32_t>(left), static_cast<uint32_t>(right));
+    const BakedKernPair* it = std::lower_bound(begin, end, pair, [](const BakedKernPair& k, const auto& value) {
+        return std::make_pair(k.left, k.right) < value;
+    });
+    return (it != end && it->left == pair.first && it->right == pair.second) ? it->adjust : 0.0f;
+}
+
+float Font::get_kerning(int left, int right) {
+    if (!has_kerning_ && fallbacks_.empty()) return 0.0f;
+
+    std::unique_lock<std::mutex> lock(cache_mutex_);
+    uint64_t key = (static_cast<uint64_t>(static_cast<uint32_t>(left)) << 32) | static_cast<uint32_t>(right);
+    if (auto it = kern_cache_.find(key); it != kern_cache_.end()) {
+        return it->second;
+    }
+
+    // 只有第一次遇到这一对字时才去翻 kern / GPOS 表；两个字来自不同字体时不做调整
+    float kern = 0.0f;
+    GlyphRef a = resolve_glyph(left);
+    GlyphRef b = resolve_glyph(right);
+    if (a.font != b.font || a.index < 0 || b.index < 0) {
+        kern = 0.0f;
+    } else if (a.font != this) {
+        // 进入后备字体前先放开本字体的锁，见 get_glyph
+        lock.unlock();
+        kern = a.font->get_kerning(left, right);
+        lock.lock();
+    } else if (has_kerning_) {
+        kern = baked_face_ ? find_baked_kerning(left, right)
+                           : stbtt_GetGlyphKernAdvance(&font_info_, a.index, b.index) * scale_;
+    }
+    kern_cache_.emplace(key, kern);
+    return kern;
+}
+
+unsigned char* Font::alloc_bitmap(size_t size) {
+    arena_bytes_ += size;
+    if (size > kArenaBlockSize / 4) {
+        // 特别大的字形单独占一块，免得浪费当前块剩余的空间
+        arena_blocks_.emplace_back(new unsigned char[size]);
+        return arena_blocks_.back().get();
+    }
+    if (arena_current_ == nullptr || arena_block_used_ + size > kArenaBlockSize) {
+        arena_blocks_.emplace_back(new unsigned char[kArenaBlockSize]);
+        arena_current_ = arena_blocks_.back().get();
+        arena_block_used_ = 0;
+    }
+    unsigned char* p = arena_current_ + arena_block_used_;
+    arena_block_used_ += size;
+    return p;
+}
+
+const Font::Glyph& Font::get_glyph(int codepoint, int subpixel) {
+    // unordered_map 的元素地址在插入时不会变，解锁后返回的引用依然有效
+    std::unique_lock<std::mutex> lock(cache_mutex_);
+    int key = codepoint * kSubpixelSteps + subpixel;
+    if (auto it = glyph_cache_.find(key); it != glyph_cache_.end()) {
+        ++cache_hits_;
+        return it->second;
+    }
+    ++cache_misses_;
+
+    // 由后备字体负责的字：点阵留在那个字体的内存池里，这里只缓存一份描述
+    Glyph glyph;
+    GlyphRef ref = resolve_glyph(codepoint);
+    if (ref.font != this) {
+        // 调用后备字体时不能拿着本字体的锁：两个字体互为后备时 (西文 -> 中文、中文 -> 西文)，
+        // 两个线程会以相反的顺序加锁而死锁。解锁期间别的线程可能已经插入了同一个字，emplace 会保留先到的那份
+        lock.unlock();
+        glyph = ref.font->get_glyph(codepoint, subpixel);
+        lock.lock();
+    } else if (baked_face_) {
+        glyph = find_baked_glyph(ref.index);
+    } else {
+        glyph = rasterize_glyph(std::max(ref.index, 0), subpixel); // 缺字画 .notdef (0 号字形)
+    }
+    return glyph_cache_.emplace(key, glyph).first->second;
+}
+
+Font::Glyph Font::rasterize_glyph(int glyph_index, int subpixel) {
+    // 获取字形的尺寸和偏移 (点阵整体右移 shift_x 个像素的小数部分)
+    float shift_x = static_cast<float>(subpixel) / kSubpixelSteps;
+    int advance_width, left_side_bearing;
+    stbtt_GetGlyphHMetrics(&font_info_, glyph_index, &advance_width, &left_side_bearing);
+
+    int x0, y0, x1, y1;
+    stbtt_GetGlyphBitmapBoxSubpixel(&font_info_, glyph_index, scale_, scale_, shift_x, 0.0f, &x0, &y0, &x1, &y1);
+
+    Glyph glyph;
+    glyph.advance = advance_width * scale_;
+    if (sdf_atlas_) {
+        // 距离场在基准字号下生成，这里只换算出本字号下的包围盒，不产生任何点阵
+        const SdfAtlas::SdfGlyph& sdf = sdf_atlas_->get_glyph(glyph_index);
+        float ratio = font_size_ / SdfAtlas::kBaseSize;
+        glyph.x0 = static_cast<int>(std::floor(sdf.x0 * ratio + shift_x));
+        glyph.y0 = static_cast<int>(std::floor(sdf.y0 * ratio));
+        glyph.width = static_cast<int>(std::ceil((sdf.x0 + sdf.width) * ratio + shift_x)) - glyph.x0;
+        glyph.height = static_cast<int>(std::ceil((sdf.y0 + sdf.height) * ratio)) - glyph.y0;
+        glyph.bitmap = nullptr;
+        glyph.sdf = sdf.field.empty() ? nullptr : &sdf;
+        glyph.sdf_ratio = ratio;
+        glyph.shift_x = shift_x;
+        if (!glyph.sdf) glyph.width = glyph.height = 0;
+        return glyph;
+    }
+    glyph.x0 = x0;
+    glyph.y0 = y0;
+    glyph.width = x1 - x0;
+    glyph.height = y1 - y0;
+    glyph.bitmap = nullptr;
+
+    // 渲染成单通道(灰度)的 Alpha 遮罩，直接写进内存池，省掉每次的 malloc/free
+    if (glyph.width > 0 && glyph.height > 0) {
+        unsigned char* bitmap = alloc_bitmap(static_cast<size_t>(glyph.width) * glyph.height);
+        stbtt_MakeGlyphBitmapSubpixel(&font_info_, bitmap, glyph.width, glyph.height, glyph.width,
+                                      scale_, scale_, shift_x, 0.0f, glyph_index);
+        glyph.bitmap = bitmap;
+    }
+    return glyph;
+}
+
+GlyphCacheStats Font::get_cache_stats() const {
+    std::lock_guard<std::mutex> lock(cache_mutex_);
+    return {cache_hits_, cache_misses_, glyph_cache_.size(), arena_bytes_};
+}
+
+Font::~Font() {
+    stop_warmup();
+}
+
+void Font::start_warmup(const std::string& charset, size_t memory_cap) {
+    stop_warmup();
+
+    std::vector<uint32_t> codepoints;
+    decode_utf8(charset, codepoints, 0);
+    std::sort(codepoints.begin(), codepoints.end());
+    codepoints.erase(std::unique(codepoints.begin(), codepoints.end()), codepoints.end());
+    codepoints.erase(std::remove_if(codepoints.begin(), codepoints.end(), [](uint32_t cp) { return cp < 0x20; }),
+                     codepoints.end());
+
+    int steps = baked_face_ ? 1 : kSubpixelSteps;
+    warmup_done_ = 0;
+    warmup_total_ = codepoints.size() * steps;
+    warmup_stop_ = false;
+    warmup_finished_ = false;
+    warmup_thread_ = std::thread(&Font::warmup_worker, this, std::move(codepoints), memory_cap);
+}
+
+void Font::warmup_worker(std::vector<uint32_t> codepoints, size_t memory_cap) {
+    // 外层按亚像素档：整像素版本最常用，内存不够时先保证它们
+    int steps = baked_face_ ? 1 : kSubpixelSteps;
+    for (int subpixel = 0; subpixel < steps; ++subpixel) {
+        for (uint32_t cp : codepoints) {
+            if (warmup_stop_) break;
+            if (chain_memory_usage() >= memory_cap) {
+                warmup_stop_ = true;
+                break;
+            }
+            // 每个字单独加锁，主线程最多等一个字的光栅化时间
+            get_glyph(static_cast<int>(cp), subpixel);
+            ++warmup_done_;
+        }
+    }
+    warmup_finished_ = true;
+}
+
+WarmupProgress Font::get_warmup_progress() const {
+    return {warmup_done_, warmup_total_, chain_memory_usage(), warmup_finished_};
+}
+
+size_t Font::memory_usage() const {
+    std::lock_guard<std::mutex> lock(cache_mutex_);
+    return arena_bytes_ + (sdf_atlas_ ? sdf_atlas_->get_memory_usage() : 0);
+}
+
+size_t Font::chain_memory_usage() const {
+    // 后备字体负责的字光栅化在它们自己的内存池里，也要算进来；
+    // 逐个字体各自加锁，不同时拿两把锁 (见 get_glyph)
+    size_t total = memory_usage();
+    for (const Font* fallback : fallbacks_) {
+        total += fallback->memory_usage();
+    }
+    return total;
+}
+
+void Font::wait_warmup() {
+    if (warmup_thread_.joinable()) {
+        warmup_thread_.join();
+    }
+}
+
+void Font::stop_warmup() {
+    warmup_stop_ = true;
+    wait_warmup();
+}
+
+std::string Font::load_charset(const std::string& spec) {
+    std::string charset;
+    size_t start = 0;
+    while (start <= spec.size()) {
+        size_t end = spec.find(',', start);
+        if (end == std::string::npos) end = spec.size();
+        std::string item = spec.substr(start, end - start);
+        start = end + 1;
+
+        if (item.empty()) {
+            continue;
+        } else if (item == "digits") {
+            charset += "0123456789";
+        } else if (item == "ascii") {
+            for (char c = 0x20; c <= 0x7E; ++c) charset += c;
+        } else {
+            // 字符表文件：UTF-8 文本，空白和换行会在预热时被忽略
+            int fd = ::open(item.c_str(), O_RDONLY);
+            if (fd < 0) {
+                throw std::runtime_error("Failed to open charset file: " + item);
+            }
+            char buffer[4096];
+            ssize_t n;
+            while ((n = read(fd, buffer, sizeof(buffer))) > 0) {
+                charset.append(buffer, n);
+            }
+            close(fd);
+        }
+    }
+    return charset;
+}
+
+int Font::get_line_height() const {
+    return ascent_ - descent_ + line_gap_;
+}
+
+// 排版：解码 + 断行 + 对齐，算出每个字相对文字块左上角的位置
+// 结果按 (文本, 最大宽度, 对齐方式) 缓存，同一个标签反复排版时直接返回
+std::shared_ptr<const TextLayout> Font::layout_text(const std::string& text, int max_width, TextAlign align) {
+    std::string key = text;
+    key.push_back('\0');
+    key += std::to_string(max_width);
+    key.push_back(static_cast<char>(align));
+    if (auto it = layout_cache_.find(key); it != layout_cache_.end()) {
+        return it->second;
+    }
+
+    // 一行里前 count 个字的前进宽度：advance 与字偶距都按浮点累加，不逐字截断
+    auto measure = [this](const std::vector<int>& line, size_t count) {
+        float width = 0.0f;
+        for (size_t k = 0; k < count; ++k) {
+            if (k > 0) width += get_kerning(line[k - 1], line[k]);
+            width += get_glyph(line[k]).advance;
+        }
+        return width;
+    };
+
+    // 1. 断行：'\n' 强制换行；超出 max_width 时在最近的空格后或中文字之间断开
+    std::vector<std::vector<int>> lines(1);
+    float line_width = 0.0f;
+    size_t break_at = 0; // 当前行里允许断开的位置 (该位置之前的字留在本行)，0 表示没有
+    // 整段文字先一次性解码 (非法字节显示为 '?')，断行和定位都只读这份码位
+    codepoints_.clear();
+    decode_utf8(text, codepoints_, '?');
+    for (uint32_t value : codepoints_) {
+        int codepoint = static_cast<int>(value);
+        if (codepoint == '\n') {
+            lines.emplace_back();
+            line_width = 0.0f;
+            break_at = 0;
+            continue;
+        }
+
+        std::vector<int>* line = &lines.back();
+        float advance = get_glyph(codepoint).advance;
+        if (!line->empty()) advance += get_kerning(line->back(), codepoint);
+        bool is_cjk = codepoint >= 0x2E80;
+        if (is_cjk && !line->empty()) break_at = line->size();
+
+        if (max_width > 0 && !line->empty() && codepoint != ' ' && line_width + advance > max_width) {
+            size_t split = break_at > 0 ? break_at : line->size();
+            std::vector<int> rest(line->begin() + split, line->end());
+            line->resize(split);
+            lines.push_back(std::move(rest));
+            line = &lines.back();
+            line_width = measure(*line, line->size());
+            advance = get_glyph(codepoint).advance;
+            if (!line->empty()) advance += get_kerning(line->back(), codepoint);
+            break_at = 0;
+        }
+
+        line->push_back(codepoint);
+        line_width += advance;
+        if (codepoint == ' ' || is_cjk) break_at = line->size();
+    }
+
+    // 2. 每行宽度 (行尾空格不计入，否则居中会偏左)
+    auto layout = std::make_shared<TextLayout>();
+    std::vector<float> exact_widths;
+    for (auto& line : lines) {
+        size_t visible = line.size();
+        while (visible > 0 && line[visible - 1] == ' ') --visible;
+        exact_widths.push_back(measure(line, visible));
+        layout->line_widths.push_back(static_cast<int>(std::ceil(exact_widths.back())));
+    }
+    int block_width = max_width > 0 ? max_width
+                                    : *std::max_element(layout->line_widths.begin(), layout->line_widths.end());
+
+    // 3. 定位：按对齐方式决定每行起点，基线 = 行顶 + ascent
+    //    笔位置全程用浮点累加，每个字再按 1/kSubpixelSteps 像素取整 (点阵字体取整到像素)
+    const int steps = baked_face_ ? 1 : kSubpixelSteps;
+    int line_height = get_line_height();
+    int ink_x0 = INT_MAX, ink_y0 = INT_MAX, ink_x1 = INT_MIN, ink_y1 = INT_MIN;
+    for (size_t row = 0; row < lines.size(); ++row) {
+        float slack = block_width - exact_widths[row];
+        float pen = align == TextAlign::CENTER ? slack / 2 : (align == TextAlign::RIGHT ? slack : 0.0f);
+        int baseline = static_cast<int>(row) * line_height + ascent_;
+
+        for (size_t k = 0; k < lines[row].size(); ++k) {
+            int codepoint = lines[row][k];
+            if (k > 0) pen += get_kerning(lines[row][k - 1], codepoint);
+
+            long quantized = std::lround(pen * steps);
+            int x = static_cast<int>(std::floor(static_cast<double>(quantized) / steps));
+            int subpixel = static_cast<int>(quantized - static_cast<long>(x) * steps);
+            const Glyph& glyph = get_glyph(codepoint, subpixel);
+            layout->glyphs.push_back({codepoint, x, subpixel, baseline});
+            if (glyph.width > 0 && glyph.height > 0) {
+                ink_x0 = std::min(ink_x0, x + glyph.x0);
+                ink_y0 = std::min(ink_y0, baseline + glyph.y0);
+                ink_x1 = std::max(ink_x1, x + glyph.x0 + glyph.width);
+                ink_y1 = std::max(ink_y1, baseline + glyph.y0 + glyph.height);
             }
-            stbtt_FreeBitmap(bitmap, nullptr); // 必须释放，否则内存泄漏
+            pen += glyph.advance;
+        }
+    }
+
+    layout->width = block_width;
+    layout->height = static_cast<int>(lines.size()) * line_height;
+    layout->ink = ink_x0 <= ink_x1 ? Rect{ink_x0, ink_y0, ink_x1 - ink_x0, ink_y1 - ink_y0} : Rect{0, 0, 0, 0};
+
+    // 缓存满了就整体清掉：界面上的文字种类有限，很快会重新填满常用的那些
+    if (layout_cache_.size() >= kMaxCachedLayouts) {
+        layout_cache_.clear();
+    }
+    layout_cache_.emplace(std::move(key), layout);
+    return layout;
+}
+
+TextLayout Font::measure_text(const std::string& text, int max_width) {
+    return *layout_text(text, max_width);
+}
+
+void Font::render_sdf(const Glyph& glyph, unsigned char* out) {
+    const SdfAtlas::SdfGlyph& sdf = *glyph.sdf;
+    float ratio = glyph.sdf_ratio;
+
+    // 距离值 -> 覆盖率：先换算成本字号下的像素距离，再在轮廓线两侧各半个像素内做 smoothstep
+    if (ratio != sdf_ramp_ratio_) {
+        for (int d = 0; d < 256; ++d) {
+            float distance = (d - SdfAtlas::kOnEdge) / SdfAtlas::kPixelDistScale * ratio;
+            float t = std::clamp(distance + 0.5f, 0.0f, 1.0f);
+            sdf_ramp_[d] = static_cast<unsigned char>(t * t * (3.0f - 2.0f * t) * 255.0f + 0.5f);
         }
+        sdf_ramp_ratio_ = ratio;
+    }
 
-        // 游标向右移动，准备画下一个字
-        current_x += (advance_width * scale_);
+    // 目标像素中心反算回距离场坐标后双线性插值 (8 位定点权重)，列方向的坐标每个字形只算一次
+    auto locate = [](float f, int size, int& index, int& weight) {
+        f = std::clamp(f, 0.0f, static_cast<float>(size - 1));
+        index = std::min(static_cast<int>(f), std::max(size - 2, 0));
+        weight = static_cast<int>((f - index) * 256.0f);
+    };
+    std::vector<int> col_index(glyph.width), col_weight(glyph.width);
+    for (int c = 0; c < glyph.width; ++c) {
+        float fx = (glyph.x0 + c + 0.5f - glyph.shift_x) / ratio - sdf.x0 - 0.5f;
+        locate(fx, sdf.width, col_index[c], col_weight[c]);
     }
+
+    int x_step = sdf.width > 1 ? 1 : 0;
+    int y_step = sdf.height > 1 ? sdf.width : 0;
+    for (int r = 0; r < glyph.height; ++r) {
+        int iy, wy;
+        locate((glyph.y0 + r + 0.5f) / ratio - sdf.y0 - 0.5f, sdf.height, iy, wy);
+        const unsigned char* row = sdf.field.data() + static_cast<size_t>(iy) * sdf.width;
+        unsigned char* dst = out + static_cast<size_t>(r) * glyph.width;
+        for (int c = 0; c < glyph.width; ++c) {
+            const unsigned char* p = row + col_index[c];
+            int wx = col_weight[c];
+            int top = p[0] * (256 - wx) + p[x_step] * wx;
+            int bottom = p[y_step] * (256 - wx) + p[y_step + x_step] * wx;
+            dst[c] = sdf_ramp_[(top * (256 - wy) + bottom * wy) >> 16];
+        }
+    }
+}
+
+const unsigned char* Font::glyph_coverage(const Glyph& glyph) {
+    if (!glyph.sdf) return glyph.bitmap;
+    sdf_scratch_.resize(static_cast<size_t>(glyph.width) * glyph.height);
+    render_sdf(glyph, sdf_scratch_.data());
+    return sdf_scratch_.data();
+}
+
+void Font::draw_glyph(Lcd& screen, const Glyph& glyph, int pen_x, int baseline, uint32_t color) {
+    if (glyph.width <= 0 || glyph.height <= 0) return;
+
+    // 【核心算法】：Alpha 混合！点阵即覆盖率，整块交给 Lcd 的混合内核，实现极其平滑的字体边缘
+    screen.blend_mask(pen_x + glyph.x0, baseline + glyph.y0, glyph.width, glyph.height,
+                      glyph_coverage(glyph), glyph.width, color);
+}
+
+void Font::draw_layout(Lcd& screen, const TextLayout& layout, int start_x, int start_y, uint32_t color) {
+    for (const auto& pos : layout.glyphs) {
+        draw_glyph(screen, get_glyph(pos.codepoint, pos.subpixel), start_x + pos.x, start_y + pos.baseline, color);
+    }
+}
+
+void Font::render_mask(const TextLayout& layout, unsigned char* mask) {
+    const Rect& ink = layout.ink;
+    for (const auto& pos : layout.glyphs) {
+        const Glyph& glyph = get_glyph(pos.codepoint, pos.subpixel);
+        if (glyph.width <= 0 || glyph.height <= 0) continue;
+        const unsigned char* coverage = glyph_coverage(glyph);
+        int left = pos.x + glyph.x0 - ink.x;
+        int top = pos.baseline + glyph.y0 - ink.y;
+        for (int r = 0; r < glyph.height; ++r) {
+            unsigned char* dst = mask + static_cast<size_t>(top + r) * ink.width + left;
+            const unsigned char* src = coverage + static_cast<size_t>(r) * glyph.width;
+            for (int c = 0; c < glyph.width; ++c) {
+                // 相邻字形的边缘可能重叠，覆盖率饱和相加
+                dst[c] = static_cast<unsigned char>(std::min(255, dst[c] + src[c]));
+            }
+        }
+    }
+}
+
+void Font::draw_text(Lcd& screen, const std::string& text, int start_x, int start_y, uint32_t color) {
+    // start_y 是文字整体的左上角，排版结果里已经把“基线 (Baseline)”换算好了
+    draw_layout(screen, *layout_text(text), start_x, start_y, color);
 }
\ No newline at end of file
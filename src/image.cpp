@@ -6,6 +6,7 @@
 #include <stdexcept>
 #include <unistd.h>
 #include <cmath> 
+#include <vector>
 
 // 将 BMP 结构体隐藏在 cpp 文件中，不对外暴露
 #pragma pack(push, 1)
@@ -35,7 +36,8 @@ struct BmpInfoHeader {
 // --- Image 类的实现 ---
 
 Image::Image(const std::string& file_path) 
-    : pixel_data_(nullptr), data_size_(0), row_bytes_(0) {
+    : width_(0), height_(0), bit_count_(0), is_opaque_(true),
+      native_format_(PixelFormat::XRGB8888), native_ready_(false), native_stride_(0) {
     
     int bmp_fd = open(file_path.c_str(), O_RDONLY);
     if (bmp_fd < 0) {
@@ -73,61 +75,141 @@ Image::Image(const std::string& file_path)
     width_ = info_header.width;
     height_ = std::abs(info_header.height);
     bit_count_ = info_header.bit_count;
-    is_bottom_up_ = (info_header.height > 0);
+    bool is_bottom_up = (info_header.height > 0); // 记录图片是否是倒置存储
 
-    row_bytes_ = (width_ * bit_count_ + 31) / 32 * 4;
+    int row_bytes = (width_ * bit_count_ + 31) / 32 * 4;
     
-    data_size_ = info_header.size_image;
-    if (data_size_ == 0) { 
-        data_size_ = row_bytes_ * height_;
+    size_t data_size = info_header.size_image;
+    if (data_size == 0) { 
+        data_size = static_cast<size_t>(row_bytes) * height_;
     }
 
-    pixel_data_ = new unsigned char[data_size_];
-
-    if (read(bmp_fd, pixel_data_, data_size_) != data_size_) {
-        delete[] pixel_data_;
+    std::vector<unsigned char> file_data(data_size);
+    if (read(bmp_fd, file_data.data(), data_size) != static_cast<ssize_t>(data_size)) {
         close(bmp_fd);
         throw std::runtime_error("Failed to read BMP pixel data");
     }
 
     close(bmp_fd);
+
+    // 加载时一次性解码：BGR(A) -> 自顶向下的 0xAARRGGBB，倒置翻转也在这里做掉
+    // 之后每次 draw 都不用再算行偏移、拆字节
+    int bytes_per_pixel = bit_count_ / 8;
+    argb_.resize(static_cast<size_t>(width_) * height_);
+    for (int y = 0; y < height_; ++y) {
+        int memory_y = is_bottom_up ? (height_ - 1 - y) : y;
+        const unsigned char* src = file_data.data() + static_cast<size_t>(memory_y) * row_bytes;
+        uint32_t* dst = argb_.data() + static_cast<size_t>(y) * width_;
+
+        for (int x = 0; x < width_; ++x, src += bytes_per_pixel) {
+            uint32_t a = (bytes_per_pixel == 4) ? src[3] : 0xFF;
+            dst[x] = (a << 24) | (src[2] << 16) | (src[1] << 8) | src[0];
+            if (a != 0xFF) {
+                is_opaque_ = false;
+            }
+        }
+    }
+
+    if (!is_opaque_) {
+        build_runs();
+    }
+}
+
+void Image::build_runs() {
+    // 把每一行切成连续的段：Alpha 为 0 的段直接跳过不记录，
+    // 全不透明的段整段拷贝，只有半透明的边缘像素才需要真正做混合
+    row_runs_.assign(height_ + 1, 0);
+    runs_.clear();
+    blend_argb_.clear();
+    for (int y = 0; y < height_; ++y) {
+        row_runs_[y] = runs_.size();
+        const uint32_t* row = argb_.data() + static_cast<size_t>(y) * width_;
+
+        int x = 0;
+        while (x < width_) {
+            uint32_t a = row[x] >> 24;
+            RunType type = (a == 0) ? RunType::SKIP : (a == 0xFF ? RunType::COPY : RunType::BLEND);
+            int run_start = x;
+            while (x < width_) {
+                uint32_t next = row[x] >> 24;
+                RunType next_type = (next == 0) ? RunType::SKIP : (next == 0xFF ? RunType::COPY : RunType::BLEND);
+                if (next_type != type) break;
+                ++x;
+            }
+            if (type == RunType::BLEND) {
+                runs_.push_back({type, run_start, x - run_start, static_cast<int>(blend_argb_.size())});
+                blend_argb_.insert(blend_argb_.end(), row + run_start, row + x);
+            } else if (type == RunType::COPY) {
+                runs_.push_back({type, run_start, x - run_start, 0});
+            }
+        }
+    }
+    row_runs_[height_] = runs_.size();
 }
 
-Image::~Image() {
-    if (pixel_data_ != nullptr) {
-        delete[] pixel_data_;
+void Image::prepare(PixelFormat format) {
+    if (argb_.empty()) {
+        restore_argb();
     }
+
+    // 转成显存原生格式，每种格式只转一次 (Alpha 通道不进显存)
+    native_stride_ = width_ * bytes_per_pixel(format);
+    native_.resize(static_cast<size_t>(native_stride_) * height_);
+    dispatch_pixel_format(format, [&](auto fmt) {
+        using Format = decltype(fmt);
+        const uint32_t* src = argb_.data();
+        uint8_t* dst = native_.data();
+        for (size_t i = 0; i < argb_.size(); ++i, dst += Format::kBytesPerPixel) {
+            Format::store(dst, Format::encode(src[i] & 0x00FFFFFF));
+        }
+    });
+    native_format_ = format;
+    native_ready_ = true;
+
+    // 之后绘制只用原生像素 (和 blend_argb_)，整张的 ARGB 副本不再需要，省下一半的像素内存
+    std::vector<uint32_t>().swap(argb_);
+}
+
+void Image::restore_argb() {
+    argb_.resize(static_cast<size_t>(width_) * height_);
+    dispatch_pixel_format(native_format_, [&](auto fmt) {
+        using Format = decltype(fmt);
+        const uint8_t* src = native_.data();
+        for (size_t i = 0; i < argb_.size(); ++i, src += Format::kBytesPerPixel) {
+            argb_[i] = 0xFF000000 | Format::decode(Format::load(src));
+        }
+    });
 }
 
 void Image::draw(Lcd& screen, int start_x, int start_y) {
-    int bytes_per_pixel = bit_count_ / 8;
+    if (!native_ready_ || native_format_ != screen.get_format()) {
+        prepare(screen.get_format());
+    }
 
+    // 不透明图片 (24 位或 Alpha 全满)：每行一次 memcpy
+    if (is_opaque_) {
+        screen.blit(start_x, start_y, width_, height_, native_.data(), native_stride_);
+        return;
+    }
+
+    // 先整体登记包围盒，后面逐段写入时就能走脏矩形的快速路径
+    screen.mark_dirty(start_x, start_y, width_, height_);
+
+    // 【透明抠图核心】：按加载时切好的段来画，完全透明的部分根本不会被访问。
+    // 这样当你把一个带透明背景的圆形黑棋画在棋盘上时，就不会有一个难看的正方形白框！
+    int bpp = bytes_per_pixel(native_format_);
     for (int y = 0; y < height_; ++y) {
-        int memory_y = is_bottom_up_ ? (height_ - 1 - y) : y;
-        
-        for (int x = 0; x < width_; ++x) {
-            int offset = memory_y * row_bytes_ + x * bytes_per_pixel;
-            uint32_t color = 0;
-
-            if (bytes_per_pixel == 3) {
-                uint8_t b = pixel_data_[offset];
-                uint8_t g = pixel_data_[offset + 1];
-                uint8_t r = pixel_data_[offset + 2];
-                color = (r << 16) | (g << 8) | b;
-            } else if (bytes_per_pixel == 4) {
-                uint8_t b = pixel_data_[offset];
-                uint8_t g = pixel_data_[offset + 1];
-                uint8_t r = pixel_data_[offset + 2];
-                uint8_t a = pixel_data_[offset + 3];
-                
-                // 【透明抠图核心】：如果 Alpha 通道为 0 (完全透明)，则跳过绘制该像素。
-                // 这样当你把一个带透明背景的圆形黑棋画在棋盘上时，就不会有一个难看的正方形白框！
-                if (a == 0) continue; 
-
-                color = (a << 24) | (r << 16) | (g << 8) | b;
+        const uint8_t* native_row = native_.data() + static_cast<size_t>(y) * native_stride_;
+
+        for (size_t i = row_runs_[y]; i < row_runs_[y + 1]; ++i) {
+            const Run& run = runs_[i];
+            if (run.type == RunType::COPY) {
+                screen.blit(start_x + run.x, start_y + y, run.length, 1,
+                            native_row + run.x * bpp, native_stride_);
+            } else {
+                // 半透明的抗锯齿边缘：与背景按 Alpha 混合，不再是生硬的锯齿
+                screen.blend_span(start_x + run.x, start_y + y, blend_argb_.data() + run.blend, run.length);
             }
-
-            screen.render_pixel(start_x + x, start_y + y, color);
         }
     }
 }
@@ -0,0 +1,67 @@
+// src/label_cache.cpp
+#include "../include/label_cache.h"
+#include <algorithm>
+
+LabelCache& LabelCache::get_instance() {
+    static LabelCache instance;
+    return instance;
+}
+
+void LabelCache::draw(Lcd& screen, Font& font, const std::string& text, int x, int y, uint32_t color,
+                      int max_width, TextAlign align) {
+    // 键：字体编号 (已隐含字号) + 排版参数 + 文本；颜色在贴图时才用，同一段文字换色不必重新光栅化
+    std::string key = std::to_string(font.get_id()) + ':' + std::to_string(max_width) + ':' +
+                      std::to_string(static_cast<int>(align)) + ':' + text;
+
+    auto it = index_.find(key);
+    if (it != index_.end()) {
+        // 命中：挪到链表头部，标记为最近使用
+        lru_.splice(lru_.begin(), lru_, it->second);
+    } else {
+        // 未命中：整段文字一次性光栅化成覆盖率 mask
+        auto layout = font.layout_text(text, max_width, align);
+        Label label;
+        label.key = key;
+        label.ink = layout->ink;
+
+        size_t pixels = static_cast<size_t>(label.ink.width) * label.ink.height;
+        if (pixels + key.size() > budget_) {
+            // 单个标签就超出了预算：不进缓存，直接按普通方式画 (否则会先把其它标签全部挤出去)
+            font.draw_layout(screen, *layout, x, y, color);
+            return;
+        }
+        label.mask.assign(pixels, 0);
+        if (pixels > 0) {
+            font.render_mask(*layout, label.mask.data());
+        }
+
+        memory_usage_ += pixels + key.size();
+        lru_.push_front(std::move(label));
+        it = index_.emplace(key, lru_.begin()).first;
+        evict_to_budget(); // 新标签在链表头部，只会淘汰别的标签
+    }
+
+    const Label& label = *it->second;
+    screen.blend_mask(x + label.ink.x, y + label.ink.y, label.ink.width, label.ink.height,
+                      label.mask.data(), label.ink.width, color);
+}
+
+void LabelCache::set_budget(size_t bytes) {
+    budget_ = bytes;
+    evict_to_budget();
+}
+
+void LabelCache::evict_to_budget() {
+    while (memory_usage_ > budget_ && !lru_.empty()) {
+        const Label& victim = lru_.back();
+        memory_usage_ -= victim.mask.size() + victim.key.size();
+        index_.erase(victim.key);
+        lru_.pop_back();
+    }
+}
+
+void LabelCache::clear_cache() {
+    lru_.clear();
+    index_.clear();
+    memory_usage_ = 0;
+}
@@ -9,98 +9,833 @@
 #include <sys/ioctl.h>  // 新增：用于 ioctl 系统调用
 #include <linux/fb.h>   // 新增：包含 Framebuffer 的结构体定义
 #include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define LCD_HAVE_NEON 1
+#endif
+
+namespace {
+
+long rect_area(const Rect& r) {
+    return static_cast<long>(r.width) * r.height;
+}
+
+// 两个矩形的最小外包矩形
+Rect rect_union(const Rect& a, const Rect& b) {
+    int x0 = std::min(a.x, b.x);
+    int y0 = std::min(a.y, b.y);
+    int x1 = std::max(a.x + a.width, b.x + b.width);
+    int y1 = std::max(a.y + a.height, b.y + b.height);
+    return {x0, y0, x1 - x0, y1 - y0};
+}
+
+bool rect_contains(const Rect& outer, const Rect& inner) {
+    return inner.x >= outer.x && inner.y >= outer.y &&
+           inner.x + inner.width <= outer.x + outer.width &&
+           inner.y + inner.height <= outer.y + outer.height;
+}
+
+// --- 纯色填充一行的内核 (所有实心填充的最底层) ---
+// 按 traits 类型重载，调用方已经做完裁剪，这里只管尽可能宽地往内存里写
+
+void fill_row(Xrgb8888, uint8_t* dst, int count, uint32_t native) {
+    uint32_t* p = reinterpret_cast<uint32_t*>(dst);
+#ifdef LCD_HAVE_NEON
+    uint32x4_t v = vdupq_n_u32(native);
+    for (; count >= 8; count -= 8, p += 8) {
+        vst1q_u32(p, v);
+        vst1q_u32(p + 4, v);
+    }
+    for (; count >= 4; count -= 4, p += 4) {
+        vst1q_u32(p, v);
+    }
+#endif
+    std::fill_n(p, count, native); // 非 NEON 平台上编译器会自动向量化
+}
+
+void fill_row(Rgb565, uint8_t* dst, int count, uint32_t native) {
+    uint16_t* p = reinterpret_cast<uint16_t*>(dst);
+#ifdef LCD_HAVE_NEON
+    uint16x8_t v = vdupq_n_u16(static_cast<uint16_t>(native));
+    for (; count >= 16; count -= 16, p += 16) {
+        vst1q_u16(p, v);
+        vst1q_u16(p + 8, v);
+    }
+    for (; count >= 8; count -= 8, p += 8) {
+        vst1q_u16(p, v);
+    }
+#endif
+    std::fill_n(p, count, static_cast<uint16_t>(native));
+}
+
+void fill_row(Rgb888, uint8_t* dst, int count, uint32_t native) {
+    // 3 字节像素没法直接宽存储：先写一个像素，然后成倍地自我复制
+    if (count <= 0) return;
+    Rgb888::store(dst, native);
+    size_t total = static_cast<size_t>(count) * Rgb888::kBytesPerPixel;
+    size_t filled = Rgb888::kBytesPerPixel;
+    while (filled < total) {
+        size_t chunk = std::min(filled, total - filled);
+        memcpy(dst + filled, dst, chunk);
+        filled += chunk;
+    }
+}
+
+// BGR 格式的原生像素值已经按 Base 编码好了，直接用 Base 的填充
+template <typename Base, PixelFormat Format>
+void fill_row(SwapRB<Base, Format>, uint8_t* dst, int count, uint32_t native) {
+    fill_row(Base{}, dst, count, native);
+}
+
+// --- Alpha 混合内核 (文字、贴图、抗锯齿圆共用) ---
+// out = (fg * a + bg * (255 - a)) / 255，除法换成精确的移位形式：
+//   x / 255 (四舍五入) == (x + 128 + ((x + 128) >> 8)) >> 8，对 0 <= x <= 255 * 255 全部成立
+// 因此 a = 0 时结果严格等于 bg，a = 255 时严格等于 fg，向量版本不需要单独处理这两种情况。
+
+// 标量版：R 和 B 放在同一个 32 位字的两个 16 位通道里一起算，G 单独算
+uint32_t blend_color(uint32_t fg, uint32_t bg, int alpha) {
+    uint32_t inv = 255 - alpha;
+    uint32_t rb = (fg & 0x00FF00FF) * alpha + (bg & 0x00FF00FF) * inv + 0x00800080;
+    uint32_t g = (fg & 0x0000FF00) * alpha + (bg & 0x0000FF00) * inv + 0x00008000;
+    rb = ((rb + ((rb >> 8) & 0x00FF00FF)) >> 8) & 0x00FF00FF;
+    g = ((g + ((g >> 8) & 0x00FFFF00)) >> 8) & 0x0000FF00;
+    return rb | g;
+}
+
+#ifdef LCD_HAVE_NEON
+// 8 个通道值同时混合：vraddhn(t, t >> 8 (舍入)) 就是上面的精确除 255
+inline uint8x8_t blend_lanes(uint8x8_t fg, uint8x8_t bg, uint8x8_t alpha) {
+    uint16x8_t t = vmull_u8(fg, alpha);
+    t = vmlal_u8(t, bg, vmvn_u8(alpha));
+    return vraddhn_u16(t, vrshrq_n_u16(t, 8));
+}
+
+// RGB565 <-> 8 位通道 (低位用高位补齐，与 Rgb565::decode 一致)
+inline void unpack565(uint16x8_t p, uint8x8_t& r, uint8x8_t& g, uint8x8_t& b) {
+    uint8x8_t r5 = vmovn_u16(vshrq_n_u16(p, 11));
+    uint8x8_t g6 = vmovn_u16(vandq_u16(vshrq_n_u16(p, 5), vdupq_n_u16(0x3F)));
+    uint8x8_t b5 = vmovn_u16(vandq_u16(p, vdupq_n_u16(0x1F)));
+    r = vorr_u8(vshl_n_u8(r5, 3), vshr_n_u8(r5, 2));
+    g = vorr_u8(vshl_n_u8(g6, 2), vshr_n_u8(g6, 4));
+    b = vorr_u8(vshl_n_u8(b5, 3), vshr_n_u8(b5, 2));
+}
+
+inline uint16x8_t pack565(uint8x8_t r, uint8x8_t g, uint8x8_t b) {
+    uint16x8_t p = vshlq_n_u16(vmovl_u8(vshr_n_u8(r, 3)), 11);
+    p = vorrq_u16(p, vshlq_n_u16(vmovl_u8(vshr_n_u8(g, 2)), 5));
+    return vorrq_u16(p, vmovl_u8(vshr_n_u8(b, 3)));
+}
+
+inline bool lanes_all(uint8x8_t v, uint64_t value) {
+    return vget_lane_u64(vreinterpret_u64_u8(v), 0) == value;
+}
+#endif
+
+// 覆盖率 mask + 纯色：mask[i] 为第 i 个像素的覆盖率 (字形点阵)
+// 返回已处理的像素个数，剩下的尾巴由调用方走标量
+#ifdef LCD_HAVE_NEON
+int blend_mask_simd(Xrgb8888, uint8_t* dst, const uint8_t* mask, int count, uint32_t color) {
+    uint8x8_t fr = vdup_n_u8((color >> 16) & 0xFF);
+    uint8x8_t fg = vdup_n_u8((color >> 8) & 0xFF);
+    uint8x8_t fb = vdup_n_u8(color & 0xFF);
+    uint32x4_t solid = vdupq_n_u32(color & 0x00FFFFFF);
+    int i = 0;
+    for (; i + 8 <= count; i += 8, dst += 32) {
+        uint8x8_t a = vld1_u8(mask + i);
+        if (lanes_all(a, 0)) continue; // 字形里大片的空白
+        if (lanes_all(a, ~0ULL)) {     // 笔画内部
+            vst1q_u32(reinterpret_cast<uint32_t*>(dst), solid);
+            vst1q_u32(reinterpret_cast<uint32_t*>(dst) + 4, solid);
+            continue;
+        }
+        uint8x8x4_t px = vld4_u8(dst); // B, G, R, X
+        px.val[0] = blend_lanes(fb, px.val[0], a);
+        px.val[1] = blend_lanes(fg, px.val[1], a);
+        px.val[2] = blend_lanes(fr, px.val[2], a);
+        vst4_u8(dst, px);
+    }
+    return i;
+}
+
+int blend_mask_simd(Rgb565, uint8_t* dst, const uint8_t* mask, int count, uint32_t color) {
+    uint8x8_t fr = vdup_n_u8((color >> 16) & 0xFF);
+    uint8x8_t fg = vdup_n_u8((color >> 8) & 0xFF);
+    uint8x8_t fb = vdup_n_u8(color & 0xFF);
+    uint16x8_t solid = vdupq_n_u16(static_cast<uint16_t>(Rgb565::encode(color)));
+    int i = 0;
+    for (; i + 8 <= count; i += 8, dst += 16) {
+        uint8x8_t a = vld1_u8(mask + i);
+        uint16_t* p = reinterpret_cast<uint16_t*>(dst);
+        if (lanes_all(a, 0)) continue;
+        if (lanes_all(a, ~0ULL)) {
+            vst1q_u16(p, solid);
+            continue;
+        }
+        uint8x8_t r, g, b;
+        unpack565(vld1q_u16(p), r, g, b);
+        vst1q_u16(p, pack565(blend_lanes(fr, r, a), blend_lanes(fg, g, a), blend_lanes(fb, b, a)));
+    }
+    return i;
+}
+
+int blend_mask_simd(Rgb888, uint8_t* dst, const uint8_t* mask, int count, uint32_t color) {
+    uint8x8_t fr = vdup_n_u8((color >> 16) & 0xFF);
+    uint8x8_t fg = vdup_n_u8((color >> 8) & 0xFF);
+    uint8x8_t fb = vdup_n_u8(color & 0xFF);
+    int i = 0;
+    for (; i + 8 <= count; i += 8, dst += 24) {
+        uint8x8_t a = vld1_u8(mask + i);
+        if (lanes_all(a, 0)) continue;
+        uint8x8x3_t px = vld3_u8(dst); // B, G, R
+        px.val[0] = blend_lanes(fb, px.val[0], a);
+        px.val[1] = blend_lanes(fg, px.val[1], a);
+        px.val[2] = blend_lanes(fr, px.val[2], a);
+        vst3_u8(dst, px);
+    }
+    return i;
+}
+
+// 0xAARRGGBB 源像素按各自 Alpha 叠加到目标上
+int blend_argb_simd(Xrgb8888, uint8_t* dst, const uint32_t* argb, int count) {
+    int i = 0;
+    for (; i + 8 <= count; i += 8, dst += 32) {
+        uint8x8x4_t src = vld4_u8(reinterpret_cast<const uint8_t*>(argb + i)); // B, G, R, A
+        uint8x8_t a = src.val[3];
+        if (lanes_all(a, 0)) continue;
+        uint8x8x4_t px = vld4_u8(dst);
+        px.val[0] = blend_lanes(src.val[0], px.val[0], a);
+        px.val[1] = blend_lanes(src.val[1], px.val[1], a);
+        px.val[2] = blend_lanes(src.val[2], px.val[2], a);
+        px.val[3] = vdup_n_u8(0);
+        vst4_u8(dst, px);
+    }
+    return i;
+}
+
+int blend_argb_simd(Rgb565, uint8_t* dst, const uint32_t* argb, int count) {
+    int i = 0;
+    for (; i + 8 <= count; i += 8, dst += 16) {
+        uint8x8x4_t src = vld4_u8(reinterpret_cast<const uint8_t*>(argb + i));
+        uint8x8_t a = src.val[3];
+        if (lanes_all(a, 0)) continue;
+        uint16_t* p = reinterpret_cast<uint16_t*>(dst);
+        uint8x8_t r, g, b;
+        unpack565(vld1q_u16(p), r, g, b);
+        vst1q_u16(p, pack565(blend_lanes(src.val[2], r, a), blend_lanes(src.val[1], g, a),
+                             blend_lanes(src.val[0], b, a)));
+    }
+    return i;
+}
+
+int blend_argb_simd(Rgb888, uint8_t* dst, const uint32_t* argb, int count) {
+    int i = 0;
+    for (; i + 8 <= count; i += 8, dst += 24) {
+        uint8x8x4_t src = vld4_u8(reinterpret_cast<const uint8_t*>(argb + i));
+        uint8x8_t a = src.val[3];
+        if (lanes_all(a, 0)) continue;
+        uint8x8x3_t px = vld3_u8(dst);
+        px.val[0] = blend_lanes(src.val[0], px.val[0], a);
+        px.val[1] = blend_lanes(src.val[1], px.val[1], a);
+        px.val[2] = blend_lanes(src.val[2], px.val[2], a);
+        vst3_u8(dst, px);
+    }
+    return i;
+}
+
+// BGR 格式：纯色先对调 R、B 再交给 Base 的版本；ARGB 源像素每次对调一小段放在栈上
+template <typename Base, PixelFormat Format>
+int blend_mask_simd(SwapRB<Base, Format>, uint8_t* dst, const uint8_t* mask, int count, uint32_t color) {
+    return blend_mask_simd(Base{}, dst, mask, count, SwapRB<Base, Format>::swap(color));
+}
+
+template <typename Base, PixelFormat Format>
+int blend_argb_simd(SwapRB<Base, Format>, uint8_t* dst, const uint32_t* argb, int count) {
+    constexpr int kChunk = 64;
+    uint32_t swapped[kChunk];
+    int done = 0;
+    while (done < count) {
+        int n = std::min(count - done, kChunk);
+        for (int i = 0; i < n; ++i) {
+            swapped[i] = SwapRB<Base, Format>::swap(argb[done + i]);
+        }
+        int k = blend_argb_simd(Base{}, dst + done * Base::kBytesPerPixel, swapped, n);
+        done += k;
+        if (k < n) break;
+    }
+    return done;
+}
+#else
+template <typename Format>
+int blend_mask_simd(Format, uint8_t*, const uint8_t*, int, uint32_t) { return 0; }
+template <typename Format>
+int blend_argb_simd(Format, uint8_t*, const uint32_t*, int) { return 0; }
+#endif
+
+// 一行的混合：先走向量版本，剩下的 (或非 NEON 平台上的全部) 逐像素处理
+template <typename Format>
+void blend_mask_row(Format format, uint8_t* dst, const uint8_t* mask, int count, uint32_t color) {
+    int done = blend_mask_simd(format, dst, mask, count, color);
+    dst += done * Format::kBytesPerPixel;
+    uint32_t native = Format::encode(color);
+    for (int i = done; i < count; ++i, dst += Format::kBytesPerPixel) {
+        int alpha = mask[i];
+        if (alpha == 0) continue;
+        if (alpha == 0xFF) {
+            Format::store(dst, native);
+        } else {
+            Format::store(dst, Format::encode(blend_color(color, Format::decode(Format::load(dst)), alpha)));
+        }
+    }
+}
+
+template <typename Format>
+void blend_argb_row(Format format, uint8_t* dst, const uint32_t* argb, int count) {
+    int done = blend_argb_simd(format, dst, argb, count);
+    dst += done * Format::kBytesPerPixel;
+    for (int i = done; i < count; ++i, dst += Format::kBytesPerPixel) {
+        int alpha = argb[i] >> 24;
+        if (alpha == 0) continue;
+        uint32_t color = argb[i] & 0x00FFFFFF;
+        if (alpha != 0xFF) {
+            color = blend_color(color, Format::decode(Format::load(dst)), alpha);
+        }
+        Format::store(dst, Format::encode(color));
+    }
+}
+
+// 根据 bpp 和 RGB 位域偏移识别显存格式，认不出的布局直接拒绝 (猜错了颜色会整体错乱)
+PixelFormat detect_pixel_format(const struct fb_var_screeninfo& vinfo) {
+    auto layout_is = [&](unsigned red, unsigned green, unsigned blue) {
+        return vinfo.red.offset == red && vinfo.green.offset == green && vinfo.blue.offset == blue;
+    };
+    switch (vinfo.bits_per_pixel) {
+        case 16:
+            if (layout_is(11, 5, 0)) return PixelFormat::RGB565;
+            if (layout_is(0, 5, 11)) return PixelFormat::BGR565;
+            break;
+        case 24:
+            if (layout_is(16, 8, 0)) return PixelFormat::RGB888;
+            if (layout_is(0, 8, 16)) return PixelFormat::BGR888;
+            break;
+        case 32:
+            if (layout_is(16, 8, 0)) return PixelFormat::XRGB8888;
+            if (layout_is(0, 8, 16)) return PixelFormat::XBGR8888;
+            break;
+    }
+    throw std::runtime_error("Unsupported LCD pixel format: " + std::to_string(vinfo.bits_per_pixel) +
+                             "bpp, red/green/blue offsets " + std::to_string(vinfo.red.offset) + "/" +
+                             std::to_string(vinfo.green.offset) + "/" + std::to_string(vinfo.blue.offset));
+}
+
+} // namespace
 
 Lcd::Lcd(const std::string& dev_path)
-    : dev_fd_(-1), lptr_(nullptr), back_lptr_(nullptr), 
-      screen_width_(800), screen_height_(480) { // 默认值垫底，防查询失败
+    : dev_fd_(-1), lptr_(nullptr), back_lptr_(nullptr), front_lptr_(nullptr), map_size_(0), page_size_(0),
+      screen_width_(800), screen_height_(480), // 默认值垫底，防查询失败
+      format_(PixelFormat::XRGB8888), bytes_per_pixel_(4), stride_(800 * 4),
+      page_flip_(false), vsync_(true), back_page_(1), sync_pending_(false),
+      headless_(false), frame_count_(0) {
+
+    if (dev_path.compare(0, strlen(kHeadlessLcdPrefix), kHeadlessLcdPrefix) == 0) {
+        init_headless(dev_path.substr(strlen(kHeadlessLcdPrefix)));
+        return;
+    }
       
     if ((dev_fd_ = open(dev_path.c_str(), O_RDWR)) < 0) {
         throw std::runtime_error("Lcd open failed: " + std::string(strerror(errno)));
     }
     
     // 【核心黑魔法】：向内核查询真实的 LCD 屏幕信息
-    struct fb_var_screeninfo vinfo;
-    if (ioctl(dev_fd_, FBIOGET_VSCREENINFO, &vinfo) == 0) {
-        screen_width_ = vinfo.xres;   // 获取真实物理宽度
-        screen_height_ = vinfo.yres;  // 获取真实物理高度
+    memset(&vinfo_, 0, sizeof(vinfo_));
+    if (ioctl(dev_fd_, FBIOGET_VSCREENINFO, &vinfo_) == 0) {
+        screen_width_ = vinfo_.xres;   // 获取真实物理宽度
+        screen_height_ = vinfo_.yres;  // 获取真实物理高度
         std::cout << "[Info] LCD real resolution: " 
                   << screen_width_ << " x " << screen_height_ 
-                  << " (" << vinfo.bits_per_pixel << "bpp)" << std::endl;
+                  << " (" << vinfo_.bits_per_pixel << "bpp)" << std::endl;
+
+        try {
+            format_ = detect_pixel_format(vinfo_);
+        } catch (...) {
+            close(dev_fd_);
+            throw;
+        }
+
+        // 虚拟分辨率至少能放下两页时，直接在显存的离屏页上画，show() 只需翻页
+        page_flip_ = vinfo_.yres_virtual >= 2 * vinfo_.yres;
     } else {
         std::cerr << "[Warn] Could not get LCD info, using default 800x480" << std::endl;
     }
+    bytes_per_pixel_ = bytes_per_pixel(format_);
+
+    // 每行字节数以驱动给出的 line_length 为准，有的驱动会在行尾做对齐填充
+    stride_ = screen_width_ * bytes_per_pixel_;
+    struct fb_fix_screeninfo finfo;
+    if (ioctl(dev_fd_, FBIOGET_FSCREENINFO, &finfo) == 0 &&
+        static_cast<int>(finfo.line_length) >= stride_) {
+        stride_ = finfo.line_length;
+    }
 
     // 内存大小现在是动态计算的
-    size_t mem_size = screen_width_ * screen_height_ * sizeof(int);
-    lptr_ = (int*)mmap(nullptr, mem_size, PROT_READ | PROT_WRITE, MAP_SHARED, dev_fd_, 0);
-    if (lptr_ == MAP_FAILED) {
+    page_size_ = static_cast<size_t>(stride_) * screen_height_;
+    map_size_ = page_flip_ ? 2 * page_size_ : page_size_;
+    void* mem = mmap(nullptr, map_size_, PROT_READ | PROT_WRITE, MAP_SHARED, dev_fd_, 0);
+    if (mem == MAP_FAILED && page_flip_) {
+        // 有些驱动只允许映射一页，那就老老实实走 memcpy
+        std::cerr << "[Warn] Could not map two LCD pages, page flipping disabled" << std::endl;
+        page_flip_ = false;
+        map_size_ = page_size_;
+        mem = mmap(nullptr, map_size_, PROT_READ | PROT_WRITE, MAP_SHARED, dev_fd_, 0);
+    }
+    if (mem == MAP_FAILED) {
         close(dev_fd_); 
         throw std::runtime_error("Lcd mmap failed: " + std::string(strerror(errno)));
     }
-    
-    // 双缓冲内存也动态分配
-    back_lptr_ = new int[screen_width_ * screen_height_];
+    lptr_ = static_cast<uint8_t*>(mem);
+    front_lptr_ = lptr_;
+
+    if (page_flip_) {
+        // 先确保显示的是第 0 页，然后在第 1 页上绘制
+        vinfo_.yoffset = 0;
+        if (ioctl(dev_fd_, FBIOPAN_DISPLAY, &vinfo_) == 0) {
+            back_lptr_ = lptr_ + page_size_;
+            std::cout << "[Info] LCD page flipping enabled" << std::endl;
+        } else {
+            std::cerr << "[Warn] FBIOPAN_DISPLAY failed, page flipping disabled" << std::endl;
+            page_flip_ = false;
+        }
+    }
+    if (!page_flip_) {
+        // 双缓冲内存也动态分配，与显存同格式同步长
+        back_lptr_ = new uint8_t[page_size_];
+    }
+
+    // 后台缓冲区刚分配时内容未定义，第一次 show() 需要整屏拷贝
+    damage_.reserve(kMaxDamageRects);
+    damage_.push_back({0, 0, screen_width_, screen_height_});
+    prev_damage_.reserve(kMaxDamageRects);
+}
+
+void Lcd::init_headless(const std::string& spec) {
+    // spec 形如 "800x480" 或 "800x480x16"，bpp 缺省为 32
+    int width = 0, height = 0, bpp = 32;
+    if (sscanf(spec.c_str(), "%dx%dx%d", &width, &height, &bpp) < 2 || width <= 0 || height <= 0) {
+        throw std::runtime_error("Invalid headless LCD spec: " + spec);
+    }
+    switch (bpp) {
+        case 16: format_ = PixelFormat::RGB565; break;
+        case 24: format_ = PixelFormat::RGB888; break;
+        case 32: format_ = PixelFormat::XRGB8888; break;
+        default: throw std::runtime_error("Unsupported headless LCD depth: " + std::to_string(bpp) + "bpp");
+    }
+
+    headless_ = true;
+    screen_width_ = width;
+    screen_height_ = height;
+    bytes_per_pixel_ = bytes_per_pixel(format_);
+    stride_ = screen_width_ * bytes_per_pixel_;
+    page_size_ = static_cast<size_t>(stride_) * screen_height_;
+    map_size_ = page_size_;
+
+    // 用一块普通内存冒充显存，其余逻辑 (脏矩形、像素格式、填充内核) 与真机完全一致
+    lptr_ = new uint8_t[page_size_]();
+    back_lptr_ = new uint8_t[page_size_]();
+    front_lptr_ = lptr_;
+    damage_.reserve(kMaxDamageRects);
+    prev_damage_.reserve(kMaxDamageRects);
+
+    if (const char* dump_dir = getenv("GOMOKU_LCD_DUMP")) {
+        frame_dump_dir_ = dump_dir;
+    }
+    std::cout << "[Info] Headless LCD: " << screen_width_ << " x " << screen_height_
+              << " (" << bpp << "bpp)" << std::endl;
 }
 
 Lcd::~Lcd() {
-    if (lptr_ && lptr_ != MAP_FAILED) {
+    if (headless_) {
+        delete[] lptr_;
+        delete[] back_lptr_;
+        return;
+    }
+    if (lptr_) {
         // 释放时同样依赖动态计算的大小
-        munmap(lptr_, screen_width_ * screen_height_ * sizeof(int));
+        munmap(lptr_, map_size_);
     }
     if (dev_fd_ >= 0) {
         close(dev_fd_);
     }
-    delete[] back_lptr_;
+    if (!page_flip_) {
+        delete[] back_lptr_;
+    }
 }
 
-void Lcd::render_pixel(int x, int y, uint32_t color) {
+template <typename Format>
+void Lcd::put_pixel(int x, int y, uint32_t native) {
     // 越界保护也自动适配了当前真实的屏幕尺寸
     if (x >= 0 && x < screen_width_ && y >= 0 && y < screen_height_) {
-        *(back_lptr_ + screen_width_ * y + x) = color;
+        // 快速路径：大多数逐像素写入都落在最近一次登记的矩形里
+        // 注意必须先登记再写入：翻页模式下登记可能触发后台页同步
+        if (damage_.empty() || !rect_contains(damage_.back(), {x, y, 1, 1})) {
+            add_damage({x, y, 1, 1});
+        }
+
+        Format::store(back_pixel_ptr(x, y), native);
     }
 }
 
-void Lcd::show() {
-    memcpy(lptr_, back_lptr_, screen_width_ * screen_height_ * sizeof(int));
+void Lcd::render_pixel(int x, int y, uint32_t color) {
+    dispatch_pixel_format(format_, [&](auto format) {
+        using Format = decltype(format);
+        put_pixel<Format>(x, y, Format::encode(color));
+    });
 }
 
-void Lcd::render_rectangle(int width, int height, int x, int y, uint32_t color) {
-    for (int iy = y; iy < y + height; ++iy) {
-        for (int ix = x; ix < x + width; ++ix) {
-            render_pixel(ix, iy, color);
+void Lcd::copy_rects(uint8_t* dst, const uint8_t* src, const std::vector<Rect>& rects) const {
+    for (const Rect& r : rects) {
+        if (r.x == 0 && r.width == screen_width_) {
+            // 整行都脏了：这几行在内存里是连续的 (连行尾填充一起)，一次拷贝搞定
+            size_t offset = static_cast<size_t>(stride_) * r.y;
+            memcpy(dst + offset, src + offset, static_cast<size_t>(stride_) * r.height);
+            continue;
         }
+        size_t row_bytes = static_cast<size_t>(r.width) * bytes_per_pixel_;
+        for (int y = r.y; y < r.y + r.height; ++y) {
+            size_t offset = static_cast<size_t>(stride_) * y + r.x * bytes_per_pixel_;
+            memcpy(dst + offset, src + offset, row_bytes);
+        }
+    }
+}
+
+void Lcd::show() {
+    if (!page_flip_) {
+        copy_rects(lptr_, back_lptr_, damage_);
+        if (!frame_dump_dir_.empty() && !damage_.empty()) {
+            char name[32];
+            snprintf(name, sizeof(name), "/frame_%05d.ppm", frame_count_++);
+            save_ppm(frame_dump_dir_ + name);
+        }
+        damage_.clear();
+        return;
+    }
+
+    // 这一帧什么都没画，不必翻页
+    if (damage_.empty()) return;
+
+    vinfo_.yoffset = back_page_ * screen_height_;
+    if (ioctl(dev_fd_, FBIOPAN_DISPLAY, &vinfo_) != 0) {
+        std::cerr << "[Warn] FBIOPAN_DISPLAY failed, falling back to memcpy" << std::endl;
+        fallback_to_memcpy();
+        return;
+    }
+
+    // 先翻页再等垂直同步：很多驱动在下一次 vblank 才真正切换显示地址，
+    // 等到这个 vblank 过去，旧的前台页才确实不在屏幕上，之后才能往里画或补同步
+    if (vsync_) {
+        int crtc = 0;
+        if (ioctl(dev_fd_, FBIO_WAITFORVSYNC, &crtc) != 0) {
+            vsync_ = false; // 驱动不支持，之后不再尝试
+        }
+    }
+
+    // 前后台互换，新的后台页要等到下一次绘制前才补上本帧的改动
+    std::swap(front_lptr_, back_lptr_);
+    back_page_ ^= 1;
+    prev_damage_.swap(damage_);
+    damage_.clear();
+    sync_pending_ = true;
+}
+
+void Lcd::sync_back_page() {
+    sync_pending_ = false;
+    copy_rects(back_lptr_, front_lptr_, prev_damage_);
+}
+
+void Lcd::fallback_to_memcpy() {
+    uint8_t* heap_back = new uint8_t[page_size_];
+    if (sync_pending_) {
+        sync_back_page();
     }
+    memcpy(heap_back, back_lptr_, page_size_);
+
+    // 回到第 0 页显示，并把整屏内容推上去
+    vinfo_.yoffset = 0;
+    ioctl(dev_fd_, FBIOPAN_DISPLAY, &vinfo_);
+    page_flip_ = false;
+    back_lptr_ = heap_back;
+    front_lptr_ = lptr_;
+    memcpy(lptr_, back_lptr_, page_size_);
+    damage_.clear();
+}
+
+void Lcd::mark_dirty(int x, int y, int width, int height) {
+    add_damage({x, y, width, height});
 }
 
-// 补齐 render_circle 的实现
-void Lcd::render_circle(int radius, int x, int y, uint32_t color) {
-    for (int iy = y - radius; iy < y + radius; ++iy) {
-        for (int ix = x - radius; ix < x + radius; ++ix) {
-            if ((ix - x) * (ix - x) + (iy - y) * (iy - y) <= (radius * radius)) {
-                render_pixel(ix, iy, color);
+void Lcd::add_damage(Rect rect) {
+    // 1. 裁剪到屏幕范围内
+    if (!clip_rect(rect)) return;
+
+    // 翻页后的第一笔绘制：先把后台页补成与前台一致，再在上面画
+    if (sync_pending_) {
+        sync_back_page();
+    }
+
+    // 2. 已经被某个脏矩形覆盖，无需登记
+    for (const Rect& r : damage_) {
+        if (rect_contains(r, rect)) return;
+    }
+
+    // 3. 合并：外包矩形不比两者面积之和更大 (重叠或相邻)，合并后不会多拷贝任何像素
+    //    合并后的矩形可能又能吞并其它矩形，所以循环直到稳定
+    bool merged = true;
+    while (merged) {
+        merged = false;
+        for (size_t i = 0; i < damage_.size(); ++i) {
+            Rect u = rect_union(damage_[i], rect);
+            if (rect_area(u) <= rect_area(damage_[i]) + rect_area(rect)) {
+                rect = u;
+                damage_.erase(damage_.begin() + i);
+                merged = true;
+                break;
             }
         }
     }
+
+    // 4. 列表已满：并入使外包面积增长最少的那个矩形
+    if (damage_.size() >= kMaxDamageRects) {
+        size_t best = 0;
+        long best_growth = -1;
+        for (size_t i = 0; i < damage_.size(); ++i) {
+            long growth = rect_area(rect_union(damage_[i], rect)) - rect_area(damage_[i]);
+            if (best_growth < 0 || growth < best_growth) {
+                best = i;
+                best_growth = growth;
+            }
+        }
+        rect = rect_union(damage_[best], rect);
+        damage_.erase(damage_.begin() + best);
+    }
+
+    damage_.push_back(rect);
 }
 
-void Lcd::clear(uint32_t color) {
-    // 自动根据真实分辨率刷屏
-    for (int y = 0; y < screen_height_; ++y) {
-        for (int x = 0; x < screen_width_; ++x) {
-            render_pixel(x, y, color);
+bool Lcd::clip_rect(Rect& rect) const {
+    int x0 = std::max(rect.x, 0);
+    int y0 = std::max(rect.y, 0);
+    int x1 = std::min(rect.x + rect.width, screen_width_);
+    int y1 = std::min(rect.y + rect.height, screen_height_);
+    if (x0 >= x1 || y0 >= y1) return false;
+    rect = {x0, y0, x1 - x0, y1 - y0};
+    return true;
+}
+
+void Lcd::fill_rect(Rect rect, uint32_t color) {
+    // 整个矩形只裁剪一次、登记一次脏区、转换一次颜色，之后按行宽写
+    if (!clip_rect(rect)) return;
+    add_damage(rect);
+
+    dispatch_pixel_format(format_, [&](auto format) {
+        using Format = decltype(format);
+        uint32_t native = Format::encode(color);
+        uint8_t* row = back_pixel_ptr(rect.x, rect.y);
+        if (rect.x == 0 && rect.width == screen_width_ && stride_ == screen_width_ * Format::kBytesPerPixel) {
+            // 整行且无行尾填充：整块内存连续，当成一行来填
+            fill_row(format, row, rect.width * rect.height, native);
+            return;
+        }
+        for (int y = 0; y < rect.height; ++y, row += stride_) {
+            fill_row(format, row, rect.width, native);
         }
+    });
+}
+
+template <typename Format>
+void Lcd::fill_span_clipped(int x0, int x1, int y, uint32_t native) {
+    if (y < 0 || y >= screen_height_) return;
+    x0 = std::max(x0, 0);
+    x1 = std::min(x1, screen_width_);
+    if (x0 < x1) {
+        fill_row(Format{}, back_pixel_ptr(x0, y), x1 - x0, native);
+    }
+}
+
+template <typename Format>
+void Lcd::blend_pixel_clipped(int x, int y, uint32_t color, int alpha) {
+    if (x < 0 || x >= screen_width_ || y < 0 || y >= screen_height_) return;
+    uint8_t* p = back_pixel_ptr(x, y);
+    uint32_t bg = Format::decode(Format::load(p));
+    Format::store(p, Format::encode(blend_color(color, bg, alpha)));
+}
+
+void Lcd::fill_span(int x, int y, int length, uint32_t color) {
+    fill_rect({x, y, length, 1}, color);
+}
+
+void Lcd::blit(int x, int y, int width, int height, const uint8_t* pixels, int src_stride) {
+    Rect rect{x, y, width, height};
+    if (!clip_rect(rect)) return;
+    add_damage(rect);
+
+    // 被裁掉的左边/上边部分要在源数据里跳过
+    const uint8_t* src = pixels + static_cast<size_t>(rect.y - y) * src_stride + (rect.x - x) * bytes_per_pixel_;
+    uint8_t* dst = back_pixel_ptr(rect.x, rect.y);
+    size_t row_bytes = static_cast<size_t>(rect.width) * bytes_per_pixel_;
+    for (int row = 0; row < rect.height; ++row, src += src_stride, dst += stride_) {
+        memcpy(dst, src, row_bytes);
+    }
+}
+
+void Lcd::blend_span(int x, int y, const uint32_t* argb, int count) {
+    Rect rect{x, y, count, 1};
+    if (!clip_rect(rect)) return;
+    add_damage(rect);
+
+    argb += rect.x - x;
+    dispatch_pixel_format(format_, [&](auto format) {
+        blend_argb_row(format, back_pixel_ptr(rect.x, rect.y), argb, rect.width);
+    });
+}
+
+void Lcd::blend_mask(int x, int y, int width, int height, const uint8_t* mask, int mask_stride, uint32_t color) {
+    Rect rect{x, y, width, height};
+    if (!clip_rect(rect)) return;
+    add_damage(rect);
+
+    mask += static_cast<size_t>(rect.y - y) * mask_stride + (rect.x - x);
+    dispatch_pixel_format(format_, [&](auto format) {
+        uint8_t* dst = back_pixel_ptr(rect.x, rect.y);
+        for (int row = 0; row < rect.height; ++row, mask += mask_stride, dst += stride_) {
+            blend_mask_row(format, dst, mask, rect.width, color);
+        }
+    });
+}
+
+void Lcd::render_rectangle(int width, int height, int x, int y, uint32_t color) {
+    fill_rect({x, y, width, height}, color);
+}
+
+// 扫描线画实心圆：每行只算出半宽，然后交给 fill_row 整段填充
+void Lcd::render_circle(int radius, int x, int y, uint32_t color, bool anti_aliased) {
+    if (radius <= 0) return;
+    if (anti_aliased) {
+        render_circle_smooth(radius, x, y, color);
+        return;
     }
+
+    // 圆覆盖 [x - r, x + r] 共 2r + 1 列/行 (以前的写法漏掉了最后一行一列)
+    add_damage({x - radius, y - radius, 2 * radius + 1, 2 * radius + 1});
+    dispatch_pixel_format(format_, [&](auto format) {
+        using Format = decltype(format);
+        uint32_t native = Format::encode(color);
+
+        // 中点法思路：从中间行往外走，半宽只会单调变小，整圆只需 O(r) 次整数比较
+        const int r2 = radius * radius;
+        int half = radius;
+        for (int dy = 0; dy <= radius; ++dy) {
+            while (half * half + dy * dy > r2) --half;
+            fill_span_clipped<Format>(x - half, x + half + 1, y + dy, native);
+            if (dy != 0) {
+                fill_span_clipped<Format>(x - half, x + half + 1, y - dy, native);
+            }
+        }
+    });
+}
+
+// 抗锯齿版本：以像素中心到圆心的距离估算覆盖率 cov = clamp(r + 0.5 - dist, 0, 1)
+// 完全覆盖的内段仍然整段填充，只有两端零星的边缘像素需要做 Alpha 混合
+void Lcd::render_circle_smooth(int radius, int x, int y, uint32_t color) {
+    const int extent = radius + 1;
+    add_damage({x - extent, y - extent, 2 * extent + 1, 2 * extent + 1});
+    dispatch_pixel_format(format_, [&](auto format) {
+        using Format = decltype(format);
+        uint32_t native = Format::encode(color);
+        const float inner2 = (radius - 0.5f) * (radius - 0.5f);
+        const float outer2 = (radius + 0.5f) * (radius + 0.5f);
+
+        for (int dy = -extent; dy <= extent; ++dy) {
+            float dy2 = static_cast<float>(dy) * dy;
+            if (dy2 >= outer2) continue;
+
+            // 内段：dist <= r - 0.5 的像素完全被覆盖
+            int inner = dy2 <= inner2 ? static_cast<int>(std::sqrt(inner2 - dy2)) : -1;
+            if (inner >= 0) {
+                fill_span_clipped<Format>(x - inner, x + inner + 1, y + dy, native);
+            }
+
+            // 边缘：内段之外、dist < r + 0.5 的像素按覆盖率混合
+            int outer = static_cast<int>(std::ceil(std::sqrt(outer2 - dy2)));
+            for (int dx = inner + 1; dx <= outer; ++dx) {
+                float coverage = radius + 0.5f - std::sqrt(dx * dx + dy2);
+                if (coverage <= 0.0f) break;
+                int alpha = coverage >= 1.0f ? 255 : static_cast<int>(coverage * 255.0f + 0.5f);
+                blend_pixel_clipped<Format>(x + dx, y + dy, color, alpha);
+                if (dx != 0) {
+                    blend_pixel_clipped<Format>(x - dx, y + dy, color, alpha);
+                }
+            }
+        }
+    });
+}
+
+void Lcd::clear(uint32_t color) {
+    // 整屏都会被覆盖，之前登记的零碎矩形全部作废，翻页后的同步也可以省掉
+    sync_pending_ = false;
+    damage_.clear();
+
+    // 自动根据真实分辨率刷屏
+    fill_rect({0, 0, screen_width_, screen_height_}, color);
 }
 
 Lcd& Lcd::get_instance(const std::string& dev_path) {
-    static Lcd instance(dev_path);
+    // 运行期切换后端：用默认路径时，环境变量 GOMOKU_LCD (如 "headless:800x480") 优先
+    // 只在第一次构造时读环境变量，之后每次调用只是返回引用
+    static Lcd instance([&dev_path] {
+        const char* env_path = getenv("GOMOKU_LCD");
+        return env_path && dev_path == kDefaultLcdPath ? std::string(env_path) : dev_path;
+    }());
     return instance;
 }
 
+void Lcd::save_ppm(const std::string& path) const {
+    FILE* fp = fopen(path.c_str(), "wb");
+    if (!fp) {
+        throw std::runtime_error("Failed to open " + path + ": " + std::string(strerror(errno)));
+    }
+
+    // 二进制 PPM (P6)：头部之后逐行写 RGB 三字节，几乎所有看图工具都能打开
+    fprintf(fp, "P6\n%d %d\n255\n", screen_width_, screen_height_);
+    std::vector<uint8_t> row(static_cast<size_t>(screen_width_) * 3);
+    dispatch_pixel_format(format_, [&](auto format) {
+        using Format = decltype(format);
+        for (int y = 0; y < screen_height_; ++y) {
+            const uint8_t* src = front_lptr_ + static_cast<size_t>(stride_) * y;
+            for (int x = 0; x < screen_width_; ++x, src += Format::kBytesPerPixel) {
+                uint32_t color = Format::decode(Format::load(src));
+                row[x * 3] = (color >> 16) & 0xFF;
+                row[x * 3 + 1] = (color >> 8) & 0xFF;
+                row[x * 3 + 2] = color & 0xFF;
+            }
+            fwrite(row.data(), 1, row.size(), fp);
+        }
+    });
+    fclose(fp);
+}
+
 // 获取屏幕缓冲区的当前像素颜色
 uint32_t Lcd::get_pixel(int x, int y) const {
     if (x >= 0 && x < screen_width_ && y >= 0 && y < screen_height_) {
-        return *(back_lptr_ + screen_width_ * y + x);
+        // 后台页尚未同步时，前台页才是最新的画面
+        const uint8_t* src = sync_pending_ ? front_lptr_ : back_lptr_;
+        const uint8_t* p = src + static_cast<size_t>(stride_) * y + x * bytes_per_pixel_;
+        return dispatch_pixel_format(format_, [p](auto format) {
+            using Format = decltype(format);
+            return Format::decode(Format::load(p));
+        });
     }
     return 0; // 越界返回黑色
 }
\ No newline at end of file
@@ -0,0 +1,52 @@
+// src/sdf_atlas.cpp
+#include "../include/sdf_atlas.h"
+#include "../include/font.h"
+#include <stdexcept>
+
+std::shared_ptr<SdfAtlas> SdfAtlas::open(const std::shared_ptr<FontFile>& file) {
+    // 与 FontFile 的登记表同样的做法：weak_ptr 登记，不让图集永远驻留
+    static std::mutex registry_mutex;
+    static std::unordered_map<const FontFile*, std::weak_ptr<SdfAtlas>> registry;
+
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    if (auto it = registry.find(file.get()); it != registry.end()) {
+        if (auto atlas = it->second.lock()) {
+            return atlas;
+        }
+    }
+
+    std::shared_ptr<SdfAtlas> atlas(new SdfAtlas(file));
+    registry[file.get()] = atlas;
+    return atlas;
+}
+
+SdfAtlas::SdfAtlas(const std::shared_ptr<FontFile>& file) : font_file_(file) {
+    if (!stbtt_InitFont(&font_info_, font_file_->data(), 0)) {
+        throw std::runtime_error("Failed to initialize stb_truetype font info");
+    }
+    scale_ = stbtt_ScaleForPixelHeight(&font_info_, kBaseSize);
+}
+
+const SdfAtlas::SdfGlyph& SdfAtlas::get_glyph(int glyph_index) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (auto it = glyphs_.find(glyph_index); it != glyphs_.end()) {
+        return it->second;
+    }
+
+    SdfGlyph glyph{0, 0, 0, 0, {}};
+    unsigned char* field = stbtt_GetGlyphSDF(&font_info_, scale_, glyph_index, kPadding, kOnEdge, kPixelDistScale,
+                                             &glyph.width, &glyph.height, &glyph.x0, &glyph.y0);
+    if (field) {
+        glyph.field.assign(field, field + static_cast<size_t>(glyph.width) * glyph.height);
+        stbtt_FreeSDF(field, nullptr);
+    } else {
+        glyph.width = glyph.height = 0; // 空白字形 (例如空格) 没有距离场
+    }
+    memory_usage_ += glyph.field.size();
+    return glyphs_.emplace(glyph_index, std::move(glyph)).first->second;
+}
+
+size_t SdfAtlas::get_memory_usage() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return memory_usage_;
+}
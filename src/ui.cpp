@@ -1,6 +1,7 @@
 // src/ui.cpp
 #include "../include/ui.h"
-// #include "../include/font.h" // 下一步实现 font 时再解开注释
+#include "../include/font.h"
+#include "../include/label_cache.h"
 
 Button::Button(int x, int y, int width, int height, const std::string& text)
     : x_(x), y_(y), width_(width), height_(height), text_(text),
@@ -50,11 +51,14 @@ void Button::draw(Lcd& screen, Font* font) {
         screen.render_rectangle(width_, height_, x_, y_, bg_color_);
     }
 
-    // 2. 绘制文字层
+    // 2. 绘制文字层：借助 Font 的排版结果实现水平、垂直绝对居中
+    //    排版结果有缓存，每帧重画按钮不会重新测量文字
     if (!text_.empty() && font != nullptr) {
-        // 这里预留给下一步的 Font 模块
-        // 理想情况是让 Font 模块计算文字的宽高，从而实现绝对居中
-        // 临时伪代码演示用法：
-        // font->draw_text(screen, text_, x_ + 10, y_ + height_ / 2, text_color_);
+        auto layout = font->layout_text(text_, width_, TextAlign::CENTER);
+        int text_y = y_ + (height_ - layout->height) / 2;
+
+        // 按钮文字是静态的：第一次画时整段光栅化并缓存，之后只是一次贴图
+        LabelCache::get_instance().draw(screen, *font, text_, x_, text_y, text_color_,
+                                        width_, TextAlign::CENTER);
     }
 }
\ No newline at end of file
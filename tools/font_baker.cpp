@@ -0,0 +1,356 @@
+// tools/font_baker.cpp
+// 离线字体烘焙工具 (在 PC 上运行)：把一组字符按给定字号预先光栅化成 .gbf 点阵字体
+//
+// 用法：font_baker --font SimSun.ttf --sizes 24,40 -o ui.gbf [--chars STR] [--charset FILE] [--scan PATH]...
+//   --font     源 TTF 文件
+//   --sizes    逗号分隔的字号 (像素高度)
+//   -o         输出文件
+//   --chars    额外需要的字符 (UTF-8)
+//   --charset  从 UTF-8 文本文件读取字符表 (空白字符忽略)
+//   --scan     扫描源码 (文件或目录下的 .cpp/.h) 里所有字符串字面量中出现的字符，可重复
+// 可打印 ASCII (0x20 ~ 0x7E) 总是会被包含。
+#include "../include/baked_font.h"
+#include "../include/utf8.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#define STB_TRUETYPE_IMPLEMENTATION
+#include "../include/stb_truetype.h"
+
+namespace {
+
+struct BakerOptions {
+    std::string font_path;
+    std::string output_path;
+    std::vector<float> sizes;
+    std::set<uint32_t> charset;
+};
+
+std::string read_file(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open " + path);
+    }
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+// 把 UTF-8 文本里的字符加入字符表，非法序列与控制字符直接跳过
+void add_utf8(const std::string& text, std::set<uint32_t>& charset) {
+    std::vector<uint32_t> codepoints;
+    decode_utf8(text, codepoints, 0);
+    for (uint32_t cp : codepoints) {
+        if (cp >= 0x20) {
+            charset.insert(cp);
+        }
+    }
+}
+
+// 粗略提取 C++ 源码里 "..." 字面量的内容 (跳过注释与字符字面量)
+void scan_source(const std::string& source, std::set<uint32_t>& charset) {
+    size_t i = 0;
+    while (i < source.size()) {
+        if (source.compare(i, 2, "//") == 0) {
+            i = source.find('\n', i);
+            if (i == std::string::npos) break;
+        } else if (source.compare(i, 2, "/*") == 0) {
+            i = source.find("*/", i + 2);
+            if (i == std::string::npos) break;
+            i += 2;
+        } else if (source[i] == '\'') {
+            // 字符字面量可能是 '\x41'、'\u4e2d' 这样的长转义：跟字符串一样扫到配对的引号为止
+            // (字符字面量不能跨行，遇到换行就停，不让一个落单的引号吞掉后面的代码)
+            for (++i; i < source.size() && source[i] != '\'' && source[i] != '\n'; ++i) {
+                if (source[i] == '\\' && i + 1 < source.size()) ++i;
+            }
+            ++i;
+        } else if (source[i] == '"') {
+            std::string literal;
+            for (++i; i < source.size() && source[i] != '"'; ++i) {
+                if (source[i] == '\\' && i + 1 < source.size()) ++i;
+                literal += source[i];
+            }
+            ++i;
+            add_utf8(literal, charset);
+        } else {
+            ++i;
+        }
+    }
+}
+
+void scan_path(const std::string& path, std::set<uint32_t>& charset) {
+    namespace fs = std::filesystem;
+    if (fs::is_directory(path)) {
+        for (const auto& entry : fs::recursive_directory_iterator(path)) {
+            std::string ext = entry.path().extension().string();
+            if (entry.is_regular_file() && (ext == ".cpp" || ext == ".h")) {
+                scan_source(read_file(entry.path().string()), charset);
+            }
+        }
+    } else {
+        scan_source(read_file(path), charset);
+    }
+}
+
+BakerOptions parse_args(int argc, char* argv[]) {
+    BakerOptions opt;
+    for (uint32_t c = 0x20; c <= 0x7E; ++c) {
+        opt.charset.insert(c);
+    }
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            throw std::runtime_error("Missing value for " + arg);
+        }
+        std::string value = argv[++i];
+        if (arg == "--font") {
+            opt.font_path = value;
+        } else if (arg == "-o") {
+            opt.output_path = value;
+        } else if (arg == "--sizes") {
+            std::stringstream ss(value);
+            std::string item;
+            while (std::getline(ss, item, ',')) {
+                opt.sizes.push_back(std::stof(item));
+            }
+        } else if (arg == "--chars") {
+            add_utf8(value, opt.charset);
+        } else if (arg == "--charset") {
+            add_utf8(read_file(value), opt.charset);
+        } else if (arg == "--scan") {
+            scan_path(value, opt.charset);
+        } else {
+            throw std::runtime_error("Unknown option " + arg);
+        }
+    }
+
+    if (opt.font_path.empty() || opt.output_path.empty() || opt.sizes.empty()) {
+        throw std::runtime_error("Usage: font_baker --font FILE.ttf --sizes 24,40 -o OUT.gbf "
+                                 "[--chars STR] [--charset FILE] [--scan PATH]...");
+    }
+    return opt;
+}
+
+// 字偶距 (字体单位)：与字号无关，所有字号共用一份，按 (left, right) 有序
+struct KernUnits {
+    uint32_t left;
+    uint32_t right;
+    int advance;
+};
+
+// GPOS 里是否有 PairPos 子表把 glyph 当作前一个字覆盖 (遍历方式与 stbtt__GetGlyphGPOSInfoAdvance 相同)
+bool gpos_covers_first(const stbtt_fontinfo& info, int glyph) {
+    stbtt_uint8* data = info.data + info.gpos;
+    if (ttUSHORT(data) != 1 || ttUSHORT(data + 2) != 0) return false;
+
+    stbtt_uint8* lookup_list = data + ttUSHORT(data + 8);
+    int lookup_count = ttUSHORT(lookup_list);
+    for (int i = 0; i < lookup_count; ++i) {
+        stbtt_uint8* lookup = lookup_list + ttUSHORT(lookup_list + 2 + 2 * i);
+        if (ttUSHORT(lookup) != 2) continue; // 只有 Pair Adjustment 会影响字偶距
+        int subtable_count = ttUSHORT(lookup + 4);
+        for (int j = 0; j < subtable_count; ++j) {
+            stbtt_uint8* table = lookup + ttUSHORT(lookup + 6 + 2 * j);
+            if (stbtt__GetCoverageIndex(table + ttUSHORT(table + 2), glyph) >= 0) return true;
+        }
+    }
+    return false;
+}
+
+// 找出字符表里所有字偶距非零的字对，不逐对查询 N² 次 (GB2312 一级字库约 1400 万对)
+std::vector<KernUnits> find_kern_pairs(const stbtt_fontinfo& info, const std::vector<uint32_t>& codepoints,
+                                       const std::vector<int>& glyph_indices) {
+    std::vector<KernUnits> pairs;
+    if (info.gpos) {
+        // GPOS 的类别字对 (PairPos 格式 2) 没法直接列举：只有被某个子表覆盖的前一个字才去查后一个字，
+        // 中文字体里被覆盖的通常只有西文和标点
+        for (size_t a = 0; a < codepoints.size(); ++a) {
+            if (!gpos_covers_first(info, glyph_indices[a])) continue;
+            for (size_t b = 0; b < codepoints.size(); ++b) {
+                int kern = stbtt_GetGlyphKernAdvance(&info, glyph_indices[a], glyph_indices[b]);
+                if (kern != 0) {
+                    pairs.push_back({codepoints[a], codepoints[b], kern});
+                }
+            }
+        }
+    } else if (info.kern) {
+        // 老式 kern 表：直接遍历表里的字对，留下两个字都在字符表里的 (一个字形可能对应多个码位)
+        std::unordered_map<int, std::vector<uint32_t>> glyph_codepoints;
+        for (size_t i = 0; i < codepoints.size(); ++i) {
+            glyph_codepoints[glyph_indices[i]].push_back(codepoints[i]);
+        }
+        std::vector<stbtt_kerningentry> table(stbtt_GetKerningTableLength(&info));
+        table.resize(stbtt_GetKerningTable(&info, table.data(), static_cast<int>(table.size())));
+        for (const stbtt_kerningentry& entry : table) {
+            auto left = glyph_codepoints.find(entry.glyph1);
+            auto right = glyph_codepoints.find(entry.glyph2);
+            if (entry.advance == 0 || left == glyph_codepoints.end() || right == glyph_codepoints.end()) continue;
+            for (uint32_t l : left->second) {
+                for (uint32_t r : right->second) {
+                    pairs.push_back({l, r, entry.advance});
+                }
+            }
+        }
+        std::sort(pairs.begin(), pairs.end(), [](const KernUnits& x, const KernUnits& y) {
+            return x.left != y.left ? x.left < y.left : x.right < y.right;
+        });
+    }
+    return pairs;
+}
+
+// 一个字号烘焙的中间结果
+struct FaceData {
+    BakedFace face;
+    std::vector<BakedGlyph> glyphs;
+    std::vector<BakedKernPair> kerns;
+    std::vector<unsigned char> bitmaps;
+};
+
+FaceData bake_face(const stbtt_fontinfo& info, float pixel_size, const std::vector<uint32_t>& codepoints,
+                   const std::vector<int>& glyph_indices, const std::vector<KernUnits>& kern_pairs) {
+    FaceData data{};
+    float scale = stbtt_ScaleForPixelHeight(&info, pixel_size);
+    int ascent, descent, line_gap;
+    stbtt_GetFontVMetrics(&info, &ascent, &descent, &line_gap);
+
+    // 与 Font 运行时的取整方式保持一致
+    data.face.pixel_size = pixel_size;
+    data.face.ascent = static_cast<int32_t>(ascent * scale);
+    data.face.descent = static_cast<int32_t>(descent * scale);
+    data.face.line_gap = static_cast<int32_t>(line_gap * scale);
+
+    for (size_t i = 0; i < codepoints.size(); ++i) {
+        int glyph_index = glyph_indices[i];
+        int advance_width, left_side_bearing;
+        stbtt_GetGlyphHMetrics(&info, glyph_index, &advance_width, &left_side_bearing);
+
+        int x0, y0, x1, y1;
+        stbtt_GetGlyphBitmapBox(&info, glyph_index, scale, scale, &x0, &y0, &x1, &y1);
+
+        BakedGlyph glyph{};
+        glyph.codepoint = codepoints[i];
+        glyph.advance = advance_width * scale;
+        glyph.x0 = static_cast<int16_t>(x0);
+        glyph.y0 = static_cast<int16_t>(y0);
+        glyph.width = static_cast<uint16_t>(std::max(0, x1 - x0));
+        glyph.height = static_cast<uint16_t>(std::max(0, y1 - y0));
+        glyph.bitmap_offset = static_cast<uint32_t>(data.bitmaps.size());
+
+        size_t bitmap_size = static_cast<size_t>(glyph.width) * glyph.height;
+        if (bitmap_size > 0) {
+            data.bitmaps.resize(data.bitmaps.size() + bitmap_size);
+            stbtt_MakeGlyphBitmap(&info, data.bitmaps.data() + glyph.bitmap_offset,
+                                  glyph.width, glyph.height, glyph.width, scale, scale, glyph_index);
+        }
+        data.glyphs.push_back(glyph);
+    }
+
+    // 字偶距：字对已经找好，这里只按字号缩放
+    for (const KernUnits& pair : kern_pairs) {
+        data.kerns.push_back({pair.left, pair.right, pair.advance * scale});
+    }
+
+    data.face.glyph_count = static_cast<uint32_t>(data.glyphs.size());
+    data.face.kern_count = static_cast<uint32_t>(data.kerns.size());
+    data.face.bitmap_size = static_cast<uint32_t>(data.bitmaps.size());
+    return data;
+}
+
+size_t align4(size_t n) {
+    return (n + 3) & ~static_cast<size_t>(3);
+}
+
+void write_font(const std::string& path, std::vector<FaceData>& faces) {
+    // 先排好每一段的偏移，再一次性写出
+    size_t offset = sizeof(BakedFontHeader) + faces.size() * sizeof(BakedFace);
+    for (auto& f : faces) {
+        f.face.glyph_offset = static_cast<uint32_t>(offset);
+        offset += f.glyphs.size() * sizeof(BakedGlyph);
+        f.face.kern_offset = static_cast<uint32_t>(offset);
+        offset += f.kerns.size() * sizeof(BakedKernPair);
+    }
+    for (auto& f : faces) {
+        f.face.bitmap_offset = static_cast<uint32_t>(offset);
+        offset = align4(offset + f.bitmaps.size());
+    }
+
+    std::vector<unsigned char> out(offset, 0);
+    BakedFontHeader header{};
+    memcpy(header.magic, kBakedFontMagic, sizeof(header.magic));
+    header.version = kBakedFontVersion;
+    header.face_count = static_cast<uint32_t>(faces.size());
+    memcpy(out.data(), &header, sizeof(header));
+
+    for (size_t i = 0; i < faces.size(); ++i) {
+        const FaceData& f = faces[i];
+        memcpy(out.data() + sizeof(header) + i * sizeof(BakedFace), &f.face, sizeof(BakedFace));
+        if (!f.glyphs.empty()) {
+            memcpy(out.data() + f.face.glyph_offset, f.glyphs.data(), f.glyphs.size() * sizeof(BakedGlyph));
+        }
+        if (!f.kerns.empty()) {
+            memcpy(out.data() + f.face.kern_offset, f.kerns.data(), f.kerns.size() * sizeof(BakedKernPair));
+        }
+        if (!f.bitmaps.empty()) {
+            memcpy(out.data() + f.face.bitmap_offset, f.bitmaps.data(), f.bitmaps.size());
+        }
+    }
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file.write(reinterpret_cast<const char*>(out.data()), out.size())) {
+        throw std::runtime_error("Failed to write " + path);
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    try {
+        BakerOptions opt = parse_args(argc, argv);
+
+        std::string ttf = read_file(opt.font_path);
+        const unsigned char* ttf_data = reinterpret_cast<const unsigned char*>(ttf.data());
+        stbtt_fontinfo info;
+        if (!stbtt_InitFont(&info, ttf_data, stbtt_GetFontOffsetForIndex(ttf_data, 0))) {
+            throw std::runtime_error("Failed to initialize stb_truetype font info");
+        }
+
+        // 字体里没有的字不烘焙，运行时查不到会按缺字处理
+        std::vector<uint32_t> codepoints;
+        std::vector<int> glyph_indices;
+        size_t missing = 0;
+        for (uint32_t cp : opt.charset) {
+            int glyph_index = stbtt_FindGlyphIndex(&info, cp);
+            if (glyph_index == 0 && cp != ' ') {
+                ++missing;
+                continue;
+            }
+            codepoints.push_back(cp);
+            glyph_indices.push_back(glyph_index);
+        }
+
+        std::vector<KernUnits> kern_pairs = find_kern_pairs(info, codepoints, glyph_indices);
+        std::vector<FaceData> faces;
+        for (float size : opt.sizes) {
+            faces.push_back(bake_face(info, size, codepoints, glyph_indices, kern_pairs));
+        }
+        write_font(opt.output_path, faces);
+
+        std::printf("Baked %zu glyphs x %zu sizes into %s (%zu missing from font)\n",
+                    codepoints.size(), faces.size(), opt.output_path.c_str(), missing);
+    } catch (std::exception& e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    return 0;
+}